@@ -0,0 +1,133 @@
+#ifndef _PrimeStats_DoneSet_h_
+#define _PrimeStats_DoneSet_h_
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PrimeStats.h"
+#include "PrimeStats.File.h"
+
+//
+// the set of primes earlier runs already evaluated, so a sweep over an
+// overlapping range can skip them.
+//
+// built at startup from existing data files: only the primes are pulled out
+// (8 bytes each, against ~9kb a record), then sorted and de-duplicated.
+//
+// lookups go through a cursor. primes within a job are ascending, so after
+// one binary search at the start of a job every further lookup just walks
+// the cursor forwards: O(1) amortised, and no hashing in the hot loop.
+//
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_DoneSet_st {
+	uint64_t* primes;
+	uint64_t  cnt;
+	uint64_t  cap;
+} PrimeStats_DoneSet_st;
+
+typedef struct PrimeStats_DoneCursor_st {
+	const PrimeStats_DoneSet_st* set;
+	uint64_t                     pos; // first prime in set >= the last probe
+} PrimeStats_DoneCursor_st;
+
+
+//------------------------------------------------------------------------------
+// a file's primes only count as done for a run with the same key lengths:
+// records of another layout can't stand in for this run's, and Merge won't
+// mix the two either.
+void
+DoneSet_AddFile(PrimeStats_DoneSet_st* set, const char* filePath,
+                const PrimeStats_KeyLens_st* lens)
+{
+	PrimeStats_File_st file;
+	PrimeStats_FileOpen(&file, filePath);
+	if (file.recsCnt && !KeyLens_Equal(&file.lens, lens)) {
+		printf("%s: key lengths differ from this run's (-l), can't use it as"
+		       " a done file\n", filePath);
+		exit(1);
+	}
+
+	if (set->cnt + file.recsCnt > set->cap) {
+		set->cap    = set->cnt + file.recsCnt;
+		set->primes = realloc(set->primes, set->cap * sizeof(*set->primes));
+		if (set->primes == NULL) {
+			printf("DoneSet_AddFile(): out of memory\n");
+			exit(1);
+		}
+	}
+	for (uint64_t i = 0; i < file.recsCnt; i++) {
+		set->primes[set->cnt++] = PrimeStats_RecPrime(PrimeStats_FileRec(&file, i));
+	}
+
+	PrimeStats_FileClose(&file);
+}
+
+int
+_doneSetCmp(const void* a, const void* b)
+{
+	const uint64_t x = *(const uint64_t*)a;
+	const uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+// sort (skipped if it already is, e.g. all input was merged) and dedupe.
+void
+DoneSet_Finish(PrimeStats_DoneSet_st* set)
+{
+	bool sorted = true;
+	for (uint64_t i = 1; i < set->cnt && sorted; i++) {
+		sorted = set->primes[i - 1] <= set->primes[i];
+	}
+	if (!sorted) {
+		qsort(set->primes, set->cnt, sizeof(*set->primes), _doneSetCmp);
+	}
+
+	uint64_t out = 0;
+	for (uint64_t i = 0; i < set->cnt; i++) {
+		if (out == 0 || set->primes[i] != set->primes[out - 1]) {
+			set->primes[out++] = set->primes[i];
+		}
+	}
+	set->cnt = out;
+}
+
+//------------------------------------------------------------------------------
+void
+DoneSet_Seek(PrimeStats_DoneCursor_st* cur, const PrimeStats_DoneSet_st* set,
+             const uint64_t prime)
+{
+	uint64_t lo = 0;
+	uint64_t hi = set->cnt;
+	while (lo < hi) {
+		const uint64_t mid = lo + (hi - lo) / 2;
+		if (set->primes[mid] < prime) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	cur->set = set;
+	cur->pos = lo;
+}
+
+// probes must be ascending after a DoneSet_Seek(); a probe that goes
+// backwards just re-seeks.
+static inline bool
+DoneSet_Has(PrimeStats_DoneCursor_st* cur, const uint64_t prime)
+{
+	const PrimeStats_DoneSet_st* set = cur->set;
+	if (cur->pos && set->primes[cur->pos - 1] >= prime) {
+		DoneSet_Seek(cur, set, prime);
+	}
+	while (cur->pos < set->cnt && set->primes[cur->pos] < prime) {
+		cur->pos++;
+	}
+	return cur->pos < set->cnt && set->primes[cur->pos] == prime;
+}
+
+
+#endif // _PrimeStats_DoneSet_h_
@@ -0,0 +1,472 @@
+#ifndef _PrimeStats_Export_h_
+#define _PrimeStats_Export_h_
+
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "PrimeStats.h"
+#include "PrimeStats.File.h"
+
+//
+// machine-readable export of the meta part of a PrimeStats data file.
+//
+//   csv  : one header row, then one row per prime.
+//   json : newline delimited, one object per prime, bits/ava as arrays with
+//          one entry per key length.
+//
+// columns are named after the file's key lengths (bits16_cnt, ...).
+//   bin  : fixed-width columnar. a header, then the prime column (u64), then
+//          every meta field as its own u32 column, all little endian:
+//
+//            char     magic[8];  "PSCOL001"
+//            uint64_t rowsCnt;
+//            uint32_t colsCnt;   including the prime column
+//            uint32_t dataOff;   where the first column starts
+//            char     colName[colsCnt][32];
+//            ...                 zero pad to dataOff (64 aligned)
+//            uint64_t prime[rowsCnt];
+//            uint32_t col  [colsCnt - 1][rowsCnt];
+//
+// formatting is hand rolled into large per-thread buffers, no printf.
+// records are cut into blocks; each round every thread formats one block
+// and the blocks are then written in order, so the output order always
+// matches the input order. the columnar format doesn't need rounds: every
+// (row, column) has a fixed offset, so threads pwrite their ranges directly.
+//
+
+typedef enum PrimeStats_ExportFmt_e {
+	PS_EXPORT_NONE = 0,
+	PS_EXPORT_CSV,
+	PS_EXPORT_JSON,
+	PS_EXPORT_BIN,
+} PrimeStats_ExportFmt_e;
+
+#define PS_EXPORT_BLOCK_RECS  16384
+#define PS_EXPORT_REC_MAX     16384 // worst case bytes per formatted record
+#define PS_EXPORT_COLNAME_LEN 32
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_ExportField_st {
+	const char* name;
+	size_t      off;
+} PrimeStats_ExportField_st;
+
+#define _PS_EXPORT_FIELD(name, field) \
+	{ name, offsetof(PrimeStats_BitsCntMeta_st, field) }
+
+static const PrimeStats_ExportField_st _exportFields[] = {
+	_PS_EXPORT_FIELD("cnt",     cnt    ),
+	_PS_EXPORT_FIELD("bit_min", bit.min),
+	_PS_EXPORT_FIELD("bit_max", bit.max),
+	_PS_EXPORT_FIELD("bit_gap", bit.gap),
+	_PS_EXPORT_FIELD("bit_sum", bit.sum),
+	_PS_EXPORT_FIELD("bit_avg", bit.avg),
+	_PS_EXPORT_FIELD("pop_min", pop.min),
+	_PS_EXPORT_FIELD("pop_max", pop.max),
+	_PS_EXPORT_FIELD("pop_gap", pop.gap),
+	_PS_EXPORT_FIELD("pop_sum", pop.sum),
+	_PS_EXPORT_FIELD("pop_avg", pop.avg),
+};
+#define PS_EXPORT_FIELDS_CNT \
+	((int)(sizeof(_exportFields) / sizeof(_exportFields[0])))
+
+static inline uint32_t
+_exportField(const PrimeStats_BitsCntMeta_st* meta, const int field)
+{
+	return *(const uint32_t*)((const char*)meta + _exportFields[field].off);
+}
+
+// the meta groups, in column order
+static const char* _exportGroups[] = { "bits", "ava" };
+
+static inline const PrimeStats_BitsCntMeta_st*
+_exportGroup(const void* rec, const int slotsCnt, const int group, const int slot)
+{
+	return group == 0 ? PrimeStats_RecMetaBits(rec, slotsCnt, slot)
+	                  : PrimeStats_RecMetaAva (rec, slotsCnt, slot);
+}
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_OutBuf_st {
+	char*  buf;
+	size_t len;
+	size_t cap;
+} PrimeStats_OutBuf_st;
+
+static const char _digits2[] =
+	"00010203040506070809" "10111213141516171819"
+	"20212223242526272829" "30313233343536373839"
+	"40414243444546474849" "50515253545556575859"
+	"60616263646566676869" "70717273747576777879"
+	"80818283848586878889" "90919293949596979899";
+
+// writes v as decimal at pos, returns the new end.
+static inline char*
+_fmtU64(char* pos, uint64_t v)
+{
+	char  tmp[20];
+	char* end = tmp + sizeof(tmp);
+	char* p   = end;
+	while (v >= 100) {
+		const uint64_t r = v % 100;
+		v /= 100;
+		p -= 2;
+		memcpy(p, &_digits2[r * 2], 2);
+	}
+	if (v >= 10) {
+		p -= 2;
+		memcpy(p, &_digits2[v * 2], 2);
+	} else {
+		*--p = '0' + v;
+	}
+	memcpy(pos, p, end - p);
+	return pos + (end - p);
+}
+
+static inline char*
+_fmtStr(char* pos, const char* str)
+{
+	const size_t len = strlen(str);
+	memcpy(pos, str, len);
+	return pos + len;
+}
+
+void
+_outBufReserve(PrimeStats_OutBuf_st* out, const size_t bytes)
+{
+	if (out->len + bytes <= out->cap) { return; }
+	while (out->len + bytes > out->cap) {
+		out->cap = out->cap ? out->cap * 2 : (1 << 20);
+	}
+	out->buf = realloc(out->buf, out->cap);
+	if (out->buf == NULL) {
+		printf("_outBufReserve(): out of memory\n");
+		exit(1);
+	}
+}
+
+void
+_outWrite(FILE* fp, const void* buf, const size_t len)
+{
+	if (len && 1 != fwrite(buf, len, 1, fp)) {
+		printf("export: write failed: %s\n", strerror(errno));
+		exit(1);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+void
+Export_CsvHeader(PrimeStats_OutBuf_st* out, const PrimeStats_KeyLens_st* lens)
+{
+	_outBufReserve(out, PS_EXPORT_REC_MAX);
+	char* pos = out->buf + out->len;
+	pos = _fmtStr(pos, "prime");
+	for (int g = 0; g < 2; g++) {
+		for (int slot = 0; slot < lens->cnt; slot++) {
+			for (int f = 0; f < PS_EXPORT_FIELDS_CNT; f++) {
+				*pos++ = ',';
+				pos = _fmtStr(pos, _exportGroups[g]);
+				pos = _fmtU64(pos, lens->len[slot]);
+				*pos++ = '_';
+				pos = _fmtStr(pos, _exportFields[f].name);
+			}
+		}
+	}
+	*pos++ = '\n';
+	out->len = pos - out->buf;
+}
+
+void
+Export_CsvRecord(PrimeStats_OutBuf_st* out, const void* rec,
+                 const PrimeStats_KeyLens_st* lens)
+{
+	_outBufReserve(out, PS_EXPORT_REC_MAX);
+	char* pos = out->buf + out->len;
+	pos = _fmtU64(pos, PrimeStats_RecPrime(rec));
+	for (int g = 0; g < 2; g++) {
+		for (int slot = 0; slot < lens->cnt; slot++) {
+			const PrimeStats_BitsCntMeta_st* meta
+				= _exportGroup(rec, lens->cnt, g, slot);
+			for (int f = 0; f < PS_EXPORT_FIELDS_CNT; f++) {
+				*pos++ = ',';
+				pos = _fmtU64(pos, _exportField(meta, f));
+			}
+		}
+	}
+	*pos++ = '\n';
+	out->len = pos - out->buf;
+}
+
+//------------------------------------------------------------------------------
+void
+Export_JsonRecord(PrimeStats_OutBuf_st* out, const void* rec,
+                  const PrimeStats_KeyLens_st* lens)
+{
+	_outBufReserve(out, PS_EXPORT_REC_MAX);
+	char* pos = out->buf + out->len;
+	pos = _fmtStr(pos, "{\"prime\":");
+	pos = _fmtU64(pos, PrimeStats_RecPrime(rec));
+	for (int g = 0; g < 2; g++) {
+		pos = _fmtStr(pos, ",\"");
+		pos = _fmtStr(pos, _exportGroups[g]);
+		pos = _fmtStr(pos, "\":[");
+		for (int slot = 0; slot < lens->cnt; slot++) {
+			const PrimeStats_BitsCntMeta_st* meta
+				= _exportGroup(rec, lens->cnt, g, slot);
+			if (slot) { *pos++ = ','; }
+			pos = _fmtStr(pos, "{\"len\":");
+			pos = _fmtU64(pos, lens->len[slot]);
+			for (int f = 0; f < PS_EXPORT_FIELDS_CNT; f++) {
+				pos = _fmtStr(pos, ",\"");
+				pos = _fmtStr(pos, _exportFields[f].name);
+				pos = _fmtStr(pos, "\":");
+				pos = _fmtU64(pos, _exportField(meta, f));
+			}
+			*pos++ = '}';
+		}
+		*pos++ = ']';
+	}
+	pos = _fmtStr(pos, "}\n");
+	out->len = pos - out->buf;
+}
+
+
+//==============================================================================
+typedef struct PrimeStats_ExportJob_st {
+	const PrimeStats_File_st* file;
+	uint64_t               statsBeg;
+	uint64_t               statsEnd;
+	PrimeStats_ExportFmt_e fmt;
+	PrimeStats_OutBuf_st   out;
+	int                    fd;      // bin only
+	uint64_t               rowsCnt; // bin only
+	uint64_t               dataOff; // bin only
+	pthread_t              thread;
+} PrimeStats_ExportJob_st;
+
+//------------------------------------------------------------------------------
+void*
+_exportTextThread(void* arg)
+{
+	PrimeStats_ExportJob_st* job = arg;
+	job->out.len = 0;
+	const PrimeStats_File_st* file = job->file;
+	for (uint64_t i = job->statsBeg; i < job->statsEnd; i++) {
+		if (job->fmt == PS_EXPORT_CSV) {
+			Export_CsvRecord (&job->out, PrimeStats_FileRec(file, i), &file->lens);
+		} else {
+			Export_JsonRecord(&job->out, PrimeStats_FileRec(file, i), &file->lens);
+		}
+	}
+	return NULL;
+}
+
+void
+_exportText(FILE* fp, const PrimeStats_File_st* file,
+            const PrimeStats_ExportFmt_e fmt, const int threadsCnt)
+{
+	const uint64_t statsCnt = file->recsCnt;
+	PrimeStats_ExportJob_st* jobs = calloc(threadsCnt, sizeof(*jobs));
+
+	if (fmt == PS_EXPORT_CSV) {
+		Export_CsvHeader(&jobs[0].out, &file->lens);
+		_outWrite(fp, jobs[0].out.buf, jobs[0].out.len);
+	}
+
+	for (uint64_t roundBeg = 0; roundBeg < statsCnt;
+	     roundBeg += (uint64_t)threadsCnt * PS_EXPORT_BLOCK_RECS)
+	{
+		int jobsCnt = 0;
+		for (int t = 0; t < threadsCnt; t++) {
+			const uint64_t beg = roundBeg + (uint64_t)t * PS_EXPORT_BLOCK_RECS;
+			if (beg >= statsCnt) { break; }
+			PrimeStats_ExportJob_st* job = &jobs[t];
+			job->file     = file;
+			job->statsBeg = beg;
+			job->statsEnd = beg + PS_EXPORT_BLOCK_RECS < statsCnt
+			              ? beg + PS_EXPORT_BLOCK_RECS : statsCnt;
+			job->fmt      = fmt;
+			if (pthread_create(&job->thread, NULL, _exportTextThread, job) != 0) {
+				printf("export: pthread_create failed\n");
+				exit(1);
+			}
+			jobsCnt++;
+		}
+		for (int t = 0; t < jobsCnt; t++) {
+			pthread_join(jobs[t].thread, NULL);
+			_outWrite(fp, jobs[t].out.buf, jobs[t].out.len);
+		}
+	}
+
+	for (int t = 0; t < threadsCnt; t++) {
+		free(jobs[t].out.buf);
+	}
+	free(jobs);
+}
+
+//------------------------------------------------------------------------------
+void
+_exportPwrite(const int fd, const void* buf, const size_t len, off_t off)
+{
+	const char* pos  = buf;
+	size_t      left = len;
+	while (left) {
+		const ssize_t n = pwrite(fd, pos, left, off);
+		if (n <= 0) {
+			printf("export: pwrite failed: %s\n", strerror(errno));
+			exit(1);
+		}
+		pos  += n;
+		off  += n;
+		left -= n;
+	}
+}
+
+void*
+_exportBinThread(void* arg)
+{
+	PrimeStats_ExportJob_st* job = arg;
+	const uint64_t rows = job->statsEnd - job->statsBeg;
+	if (rows == 0) { return NULL; }
+
+	_outBufReserve(&job->out, rows * sizeof(uint64_t));
+
+	const PrimeStats_File_st* file = job->file;
+	uint64_t* primes = (uint64_t*)job->out.buf;
+	for (uint64_t i = 0; i < rows; i++) {
+		primes[i] = PrimeStats_RecPrime(PrimeStats_FileRec(file, job->statsBeg + i));
+	}
+	_exportPwrite(job->fd, primes, rows * sizeof(uint64_t),
+	              job->dataOff + job->statsBeg * sizeof(uint64_t));
+
+	uint64_t colOff = job->dataOff + job->rowsCnt * sizeof(uint64_t);
+	uint32_t* col = (uint32_t*)job->out.buf;
+	for (int g = 0; g < 2; g++) {
+		for (int slot = 0; slot < file->lens.cnt; slot++) {
+			for (int f = 0; f < PS_EXPORT_FIELDS_CNT; f++) {
+				for (uint64_t i = 0; i < rows; i++) {
+					const void* rec = PrimeStats_FileRec(file, job->statsBeg + i);
+					col[i] = _exportField(_exportGroup(rec, file->lens.cnt, g, slot), f);
+				}
+				_exportPwrite(job->fd, col, rows * sizeof(uint32_t),
+				              colOff + job->statsBeg * sizeof(uint32_t));
+				colOff += job->rowsCnt * sizeof(uint32_t);
+			}
+		}
+	}
+	return NULL;
+}
+
+void
+_exportBin(const int fd, const PrimeStats_File_st* file, const int threadsCnt)
+{
+	const uint64_t statsCnt = file->recsCnt;
+	const uint32_t colsCnt  = 1 + 2 * file->lens.cnt * PS_EXPORT_FIELDS_CNT;
+	uint32_t dataOff = 24 + colsCnt * PS_EXPORT_COLNAME_LEN;
+	dataOff = (dataOff + 63) & ~63u;
+
+	char* hdr = calloc(1, dataOff);
+	memcpy(hdr,      "PSCOL001", 8);
+	memcpy(hdr +  8, &statsCnt, sizeof(uint64_t));
+	memcpy(hdr + 16, &colsCnt,  sizeof(uint32_t));
+	memcpy(hdr + 20, &dataOff,  sizeof(uint32_t));
+	char* name = hdr + 24;
+	snprintf(name, PS_EXPORT_COLNAME_LEN, "prime");
+	for (int g = 0; g < 2; g++) {
+		for (int slot = 0; slot < file->lens.cnt; slot++) {
+			for (int f = 0; f < PS_EXPORT_FIELDS_CNT; f++) {
+				name += PS_EXPORT_COLNAME_LEN;
+				snprintf(name, PS_EXPORT_COLNAME_LEN, "%s%d_%s",
+				         _exportGroups[g], file->lens.len[slot], _exportFields[f].name);
+			}
+		}
+	}
+	_exportPwrite(fd, hdr, dataOff, 0);
+	free(hdr);
+
+	// one contiguous range per thread, in blocks so the scratch buffer stays
+	// bounded.
+	PrimeStats_ExportJob_st* jobs = calloc(threadsCnt, sizeof(*jobs));
+	for (uint64_t roundBeg = 0; roundBeg < statsCnt;
+	     roundBeg += (uint64_t)threadsCnt * PS_EXPORT_BLOCK_RECS)
+	{
+		int jobsCnt = 0;
+		for (int t = 0; t < threadsCnt; t++) {
+			const uint64_t beg = roundBeg + (uint64_t)t * PS_EXPORT_BLOCK_RECS;
+			if (beg >= statsCnt) { break; }
+			PrimeStats_ExportJob_st* job = &jobs[t];
+			job->file     = file;
+			job->statsBeg = beg;
+			job->statsEnd = beg + PS_EXPORT_BLOCK_RECS < statsCnt
+			              ? beg + PS_EXPORT_BLOCK_RECS : statsCnt;
+			job->fd       = fd;
+			job->rowsCnt  = statsCnt;
+			job->dataOff  = dataOff;
+			if (pthread_create(&job->thread, NULL, _exportBinThread, job) != 0) {
+				printf("export: pthread_create failed\n");
+				exit(1);
+			}
+			jobsCnt++;
+		}
+		for (int t = 0; t < jobsCnt; t++) {
+			pthread_join(jobs[t].thread, NULL);
+		}
+	}
+
+	for (int t = 0; t < threadsCnt; t++) {
+		free(jobs[t].out.buf);
+	}
+	free(jobs);
+}
+
+//------------------------------------------------------------------------------
+// filePath NULL writes csv/json to stdout. bin needs a real file.
+void
+PrimeStats_Export(const char* filePath, const PrimeStats_ExportFmt_e fmt,
+                  const PrimeStats_File_st* file, int threadsCnt)
+{
+	if (threadsCnt < 1) { threadsCnt = 1; }
+
+	if (fmt == PS_EXPORT_BIN) {
+		if (filePath == NULL) {
+			printf("export: bin needs an output file\n");
+			exit(1);
+		}
+		const int fd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			printf("export: can't open %s: %s\n", filePath, strerror(errno));
+			exit(1);
+		}
+		_exportBin(fd, file, threadsCnt);
+		close(fd);
+		return;
+	}
+
+	FILE* fp = stdout;
+	if (filePath) {
+		fp = fopen(filePath, "w");
+		if (fp == NULL) {
+			printf("export: can't open %s: %s\n", filePath, strerror(errno));
+			exit(1);
+		}
+	}
+	_exportText(fp, file, fmt, threadsCnt);
+	if (fflush(fp) != 0 || (fp != stdout && fclose(fp) != 0)) {
+		printf("export: write failed: %s\n", strerror(errno));
+		exit(1);
+	}
+}
+
+
+#endif // _PrimeStats_Export_h_
@@ -0,0 +1,161 @@
+#ifndef _PrimeStats_File_h_
+#define _PrimeStats_File_h_
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PrimeStats.h"
+#include "PrimeStats.Util.h"
+
+//
+// PrimeStats data files.
+//
+// a file starts with a 64 byte header saying which key lengths its records
+// hold, followed by packed records (see PrimeStats_Pack). files written
+// before key lengths were configurable have no header: they're just
+// PrimeStats_st records for lengths 1..8, which is the same thing as packed
+// records for all PS_KEYLEN_SLOTS slots. the header magic is even when read
+// as a little-endian u64, so it can never be mistaken for a prime.
+//
+
+#define PS_FILE_MAGIC   0x3256737461745350ull // "PStatsV2"
+#define PS_FILE_VERSION 2
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_FileHdr_st {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t recSize;
+	uint32_t lensCnt;
+	uint8_t  lens[PS_KEYLEN_SLOTS];
+	uint8_t  pad[64 - 20 - PS_KEYLEN_SLOTS];
+} PrimeStats_FileHdr_st;
+
+_Static_assert(sizeof(PrimeStats_FileHdr_st) == 64, "file header must be 64 bytes");
+
+typedef struct PrimeStats_File_st {
+	      char                  filePath[1024];
+	const void*                 map;
+	      off_t                 mapSize;
+	      PrimeStats_KeyLens_st lens;
+	      size_t                recSize;
+	      size_t                hdrSize;  // 0 for headerless (old) files
+	const uint8_t*              recs;
+	      uint64_t              recsCnt;
+} PrimeStats_File_st;
+
+
+//------------------------------------------------------------------------------
+void
+PrimeStats_FileHdrInit(PrimeStats_FileHdr_st* hdr,
+                       const PrimeStats_KeyLens_st* lens)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic   = PS_FILE_MAGIC;
+	hdr->version = PS_FILE_VERSION;
+	hdr->recSize = PrimeStats_RecSize(lens->cnt);
+	hdr->lensCnt = lens->cnt;
+	for (int i = 0; i < lens->cnt; i++) {
+		hdr->lens[i] = lens->len[i];
+	}
+}
+
+//------------------------------------------------------------------------------
+// maps a data file and works out its layout. an empty file is fine (no
+// records, default layout) since mmap can't map 0 bytes.
+void
+PrimeStats_FileOpen(PrimeStats_File_st* file, const char* filePath)
+{
+	memset(file, 0, sizeof(*file));
+	snprintf(file->filePath, sizeof(file->filePath), "%s", filePath);
+	KeyLens_Default(&file->lens);
+
+	struct stat s;
+	if (stat(filePath, &s) < 0) {
+		printf("stat failed: %s: %s\n", filePath, strerror(errno));
+		exit(1);
+	}
+	if (s.st_size == 0) {
+		file->recSize = PrimeStats_RecSize(file->lens.cnt);
+		return;
+	}
+	file->map = mmapFileToPtr(filePath, &file->mapSize);
+
+	const PrimeStats_FileHdr_st* hdr = file->map;
+	if (   (size_t)file->mapSize >= sizeof(*hdr)
+	    && hdr->magic == PS_FILE_MAGIC)
+	{
+		if (   hdr->version != PS_FILE_VERSION
+		    || hdr->lensCnt < 1 || hdr->lensCnt > PS_KEYLEN_SLOTS
+		    || hdr->recSize != PrimeStats_RecSize(hdr->lensCnt)) {
+			printf("%s: unsupported or corrupt header\n", filePath);
+			exit(1);
+		}
+		file->lens.cnt = hdr->lensCnt;
+		for (uint32_t i = 0; i < hdr->lensCnt; i++) {
+			file->lens.len[i] = hdr->lens[i];
+		}
+		file->hdrSize = sizeof(*hdr);
+	}
+	file->recSize = PrimeStats_RecSize(file->lens.cnt);
+	file->recs    = (const uint8_t*)file->map + file->hdrSize;
+
+	const uint64_t bytes = file->mapSize - file->hdrSize;
+	if (bytes % file->recSize) {
+		printf("%s: size isn't a multiple of the record size\n", filePath);
+		exit(1);
+	}
+	file->recsCnt = bytes / file->recSize;
+}
+
+void
+PrimeStats_FileClose(PrimeStats_File_st* file)
+{
+	if (file->map) {
+		munmap((void*)file->map, file->mapSize);
+	}
+	memset(file, 0, sizeof(*file));
+}
+
+static inline const void*
+PrimeStats_FileRec(const PrimeStats_File_st* file, const uint64_t i)
+{
+	return file->recs + i * file->recSize;
+}
+
+//------------------------------------------------------------------------------
+// gets an output file ready to be appended to with lens' records: a new or
+// empty file gets the header, an existing one has to have the same layout.
+void
+PrimeStats_FileOutInit(const char* filePath, const PrimeStats_KeyLens_st* lens)
+{
+	struct stat s;
+	if (stat(filePath, &s) == 0 && s.st_size > 0) {
+		PrimeStats_File_st file;
+		PrimeStats_FileOpen(&file, filePath);
+		const bool same = KeyLens_Equal(&file.lens, lens);
+		PrimeStats_FileClose(&file);
+		if (!same) {
+			printf("%s: exists with different key lengths\n", filePath);
+			exit(1);
+		}
+		return;
+	}
+
+	PrimeStats_FileHdr_st hdr;
+	PrimeStats_FileHdrInit(&hdr, lens);
+	FILE* fp = fopen(filePath, "w");
+	if (fp == NULL || 1 != fwrite(&hdr, sizeof(hdr), 1, fp) || fclose(fp)) {
+		printf("%s: can't write header: %s\n", filePath, strerror(errno));
+		exit(1);
+	}
+}
+
+
+#endif // _PrimeStats_File_h_
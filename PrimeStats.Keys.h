@@ -0,0 +1,182 @@
+#ifndef _PrimeStats_Keys_h_
+#define _PrimeStats_Keys_h_
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PrimeStats.h"
+#include "PrimeStats.Util.h"
+
+//
+// the key sets a run hashes, one mapped key file per configured key length.
+// with an alphabet, lengths up to PS_KEYGEN_LEN_MAX are generated instead
+// (every key over the alphabet, see PrimeStats_RunKeysGen) and need no file.
+//
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_KeyFileKeys_st {
+	      char     filePath[1024];
+	      off_t    fileSize;
+	const void*    keys;
+	      uint64_t keyCnt;
+	      int      keyLen;
+	      bool     gen;      // enumerated, keys stays NULL
+} PrimeStats_KeyFileKeys_st;
+
+// keyFile[] is indexed by slot, same as the stats arrays
+typedef struct PrimeStats_KeyFiles_st {
+	PrimeStats_KeyFileKeys_st keyFile[PS_KEYLEN_SLOTS];
+	int                       keyLenMax;
+	int                       keyFilesCnt;
+	PrimeStats_Alphabet_st    alphabet;  // for the gen slots
+} PrimeStats_KeyFiles_st;
+
+
+//------------------------------------------------------------------------------
+// key files are named exactly toks.len.sequential.<keyLen>.<keyCnt>.txt.
+// two of them for the same length is an error: which one readdir() gives
+// first isn't something results should depend on.
+bool
+keyFileInit(PrimeStats_KeyFiles_st* keyFiles, const PrimeStats_KeyLens_st* lens,
+            const char* dirName, const char* fileName)
+{
+	int      keyLen  = 0;
+	uint64_t keyCnt  = 0;
+	int      nameLen = 0;
+	if (   2 != sscanf(fileName, "toks.len.sequential.%d.%"SCNu64".txt%n",
+	                   &keyLen, &keyCnt, &nameLen)
+	    || (size_t)nameLen != strlen(fileName)) {
+		return false;
+	}
+
+	int slot = 0;
+	while (slot < lens->cnt && lens->len[slot] != keyLen) { slot++; }
+	if (slot == lens->cnt)                  { return false; }
+	if (keyFiles->keyFile[slot].gen)        { return false; }
+	if (keyFiles->keyFile[slot].keys) {
+		printf("more than one key file for length %d in %s: %s and %s\n",
+		       keyLen, dirName, keyFiles->keyFile[slot].filePath, fileName);
+		exit(1);
+	}
+
+	PrimeStats_KeyFileKeys_st* keyFile = &keyFiles->keyFile[slot];
+	snprintf(keyFile->filePath, sizeof(keyFile->filePath), "%s%s",
+	         dirName, fileName);
+
+	keyFile->keyLen = keyLen;
+	keyFile->keyCnt = keyCnt;
+	keyFile->keys   = mmapFileToPtr(keyFile->filePath, &keyFile->fileSize);
+
+	// never read past the end, whatever the name says
+	if ((uint64_t)keyFile->fileSize < keyCnt * keyLen) {
+		keyFile->keyCnt = keyFile->fileSize / keyLen;
+	}
+
+	return true;
+}
+
+// true if every configured length can be generated, so no keys dir is needed
+bool
+KeyFiles_AllGen(const PrimeStats_KeyLens_st* lens,
+                const PrimeStats_Alphabet_st* alphabet)
+{
+	for (int slot = 0; slot < lens->cnt; slot++) {
+		if (alphabet == NULL || lens->len[slot] > PS_KEYGEN_LEN_MAX) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// finds the key file for every configured length in dirName. with an
+// alphabet (may be NULL) the short lengths are generated instead, and
+// dirName may be NULL if that's all of them.
+void
+keyFilesInit(PrimeStats_KeyFiles_st* keyFiles, const PrimeStats_KeyLens_st* lens,
+             const char* dirName, const PrimeStats_Alphabet_st* alphabet)
+{
+	if (alphabet) {
+		keyFiles->alphabet = *alphabet;
+		for (int slot = 0; slot < lens->cnt; slot++) {
+			if (lens->len[slot] > PS_KEYGEN_LEN_MAX) { continue; }
+			PrimeStats_KeyFileKeys_st* keyFile = &keyFiles->keyFile[slot];
+			keyFile->gen    = true;
+			keyFile->keyLen = lens->len[slot];
+			keyFile->keyCnt = Alphabet_KeysCnt(alphabet, keyFile->keyLen);
+			snprintf(keyFile->filePath, sizeof(keyFile->filePath),
+			         "(generated, %d byte alphabet)", alphabet->cnt);
+		}
+	}
+
+	if (dirName) {
+		DIR *dKeys = opendir(dirName);
+		if (!dKeys) {
+			printf("couldn't open key files dir\n");
+			exit(1);
+		}
+		struct dirent *dirKeys;
+		while ((dirKeys = readdir(dKeys)) != NULL) {
+			keyFileInit(keyFiles, lens, dirName, dirKeys->d_name);
+		}
+		closedir(dKeys);
+	}
+
+	keyFiles->keyFilesCnt = lens->cnt;
+	keyFiles->keyLenMax   = 0;
+	for (int slot = 0; slot < lens->cnt; slot++) {
+		if (keyFiles->keyFile[slot].keys == NULL && !keyFiles->keyFile[slot].gen) {
+			printf("no toks.len.sequential.%d.*.txt in %s\n",
+			       lens->len[slot], dirName ? dirName : "(no keys dir)");
+			exit(1);
+		}
+		if (lens->len[slot] > keyFiles->keyLenMax) {
+			keyFiles->keyLenMax = lens->len[slot];
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// keys actually hashed per prime, with at most maxKeys taken from each file
+// (generated keys aren't capped).
+uint64_t
+KeyFiles_KeysTotal(const PrimeStats_KeyFiles_st* keyFiles, const uint64_t maxKeys)
+{
+	uint64_t keysTotal = 0;
+	for (int i = 0; i < keyFiles->keyFilesCnt; ++i) {
+		const PrimeStats_KeyFileKeys_st* keyFile = &keyFiles->keyFile[i];
+		keysTotal += keyFile->keyCnt > maxKeys && !keyFile->gen
+		           ? maxKeys : keyFile->keyCnt;
+	}
+	return keysTotal;
+}
+
+// every key file into stats, slot i from keyFile[i].
+void
+PrimeStats_RunKeyFiles(PrimeStats_st* stats,
+                       const PrimeStats_KeyFiles_st* keyFiles,
+                       const uint64_t maxKeys)
+{
+	for (int iKeyFile = 0; iKeyFile < keyFiles->keyFilesCnt; iKeyFile++) {
+		if (keyFiles->keyFile[iKeyFile].gen) {
+			PrimeStats_RunKeysGen(stats,
+			                      iKeyFile,
+			                      keyFiles->keyFile[iKeyFile].keyLen,
+			                      &keyFiles->alphabet);
+			continue;
+		}
+		PrimeStats_RunKeys(stats,
+		                   iKeyFile,
+		                   keyFiles->keyFile[iKeyFile].keys,
+		                   keyFiles->keyFile[iKeyFile].keyLen,
+		                   keyFiles->keyFile[iKeyFile].keyCnt,
+		                   maxKeys);
+	}
+}
+
+
+#endif // _PrimeStats_Keys_h_
@@ -0,0 +1,460 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "PrimeStats.h"
+#include "PrimeStats.Util.h"
+#include "PrimeStats.File.h"
+
+//
+// k-way merges the outputs of a sharded run (PrimeStats.main -s i/N) into one
+// file sorted by prime, which PrimeStats_Find() can then binary search.
+//
+// a shard's output is a series of ascending runs (one per prime file slice,
+// and the files themselves are only sorted by name), so every input is first
+// cut into its ascending runs and all runs from all inputs are merged through
+// one min-heap. inputs are mmap'd and read front to back, output goes through
+// a large stdio buffer into <out>.tmp, renamed over <out> once complete. so
+// the output can be one of the inputs, e.g. to sort a single multi-worker
+// file in place.
+//
+// all inputs must hold the same key lengths; records are copied as is.
+//
+// duplicate primes are dropped, the first one wins: the record from the
+// earliest input on the command line (earliest run within an input).
+//
+// coverage is checked against the .shard manifests the sweep writes next to
+// each output: all N shards of the same file list must be there, their slices
+// must tile every prime file, and each shard's record count must match what
+// its manifest says.
+//
+
+
+//==============================================================================
+static char* file_out_data = NULL;
+static bool  no_verify     = false;
+
+#define PS_MERGE_OUT_BUF (64 << 20)
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_ShardFile_st {
+	char     fileName[256];
+	uint64_t primeCnt;
+	uint64_t primeBeg;
+	uint64_t primeEnd;
+} PrimeStats_ShardFile_st;
+
+typedef struct PrimeStats_Shard_st {
+	      PrimeStats_File_st       file;
+	// from the manifest
+	      int                      shardIdx;
+	      int                      shardCnt;
+	      uint64_t                 existingCnt; // already there before the run
+	      uint64_t                 recordsCnt;  // written by the run
+	      uint64_t                 skippedCnt; // already in an earlier run's data
+	      PrimeStats_ShardFile_st* files;
+	      int                      filesCnt;
+} PrimeStats_Shard_st;
+
+typedef struct PrimeStats_MergeRun_st {
+	const uint8_t* pos;
+	const uint8_t* end;
+	uint64_t       prime; // at pos
+	int            idx;   // in input order, breaks ties on prime
+} PrimeStats_MergeRun_st;
+
+
+//------------------------------------------------------------------------------
+bool
+shardManifestRead(PrimeStats_Shard_st* shard)
+{
+	char manifestPath[1024 + 8];
+	snprintf(manifestPath, sizeof(manifestPath), "%s.shard",
+	         shard->file.filePath);
+
+	FILE* fp = fopen(manifestPath, "r");
+	if (fp == NULL) {
+		return false;
+	}
+
+	int  filesCap = 64;
+	char line[1024];
+	shard->files    = malloc(filesCap * sizeof(*shard->files));
+	shard->shardIdx = -1; // stays out of range if there's no shard line
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (shard->filesCnt == filesCap) {
+			filesCap *= 2;
+			shard->files = realloc(shard->files, filesCap * sizeof(*shard->files));
+		}
+		PrimeStats_ShardFile_st* file = &shard->files[shard->filesCnt];
+		if (4 == sscanf(line, "file %255s %"SCNu64" %"SCNu64" %"SCNu64,
+		                file->fileName, &file->primeCnt,
+		                &file->primeBeg, &file->primeEnd)) {
+			shard->filesCnt++;
+		} else {
+			sscanf(line, "shard %d %d", &shard->shardIdx, &shard->shardCnt);
+			sscanf(line, "existing %"SCNu64, &shard->existingCnt);
+			sscanf(line, "records %"SCNu64, &shard->recordsCnt);
+			sscanf(line, "skipped %"SCNu64, &shard->skippedCnt);
+		}
+	}
+	fclose(fp);
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void
+shardOpen(PrimeStats_Shard_st* shard, const char* filePath)
+{
+	memset(shard, 0, sizeof(*shard));
+	PrimeStats_FileOpen(&shard->file, filePath);
+
+	if (!shardManifestRead(shard)) {
+		shard->shardCnt = -1;
+	}
+}
+
+//------------------------------------------------------------------------------
+// every shard of the same run, and every slice of every prime file, once.
+bool
+shardsVerify(PrimeStats_Shard_st* shards, const int shardsCnt)
+{
+	bool ok = true;
+
+	for (int i = 0; i < shardsCnt; i++) {
+		if (shards[i].shardCnt < 0) {
+			printf("verify: %s: no .shard manifest (incomplete run?)\n",
+			       shards[i].file.filePath);
+			return false;
+		}
+		// everything below indexes by shardIdx
+		if (   shards[i].shardCnt < 1
+		    || shards[i].shardIdx < 0
+		    || shards[i].shardIdx >= shards[i].shardCnt) {
+			printf("verify: %s.shard: missing or bad \"shard i N\" line\n",
+			       shards[i].file.filePath);
+			return false;
+		}
+	}
+
+	const int shardCnt = shards[0].shardCnt;
+	if (shardsCnt != shardCnt) {
+		printf("verify: got %d inputs for a %d-shard run\n", shardsCnt, shardCnt);
+		ok = false;
+	}
+
+	PrimeStats_Shard_st** byIdx = calloc(shardCnt, sizeof(*byIdx));
+	for (int i = 0; i < shardsCnt; i++) {
+		PrimeStats_Shard_st* shard = &shards[i];
+		if (shard->shardCnt != shardCnt) {
+			printf("verify: %s: is from a %d-shard run, not %d\n",
+			       shard->file.filePath, shard->shardCnt, shardCnt);
+			ok = false;
+			continue;
+		}
+		if (byIdx[shard->shardIdx]) {
+			printf("verify: shard %d given twice: %s, %s\n", shard->shardIdx,
+			       byIdx[shard->shardIdx]->file.filePath, shard->file.filePath);
+			ok = false;
+			continue;
+		}
+		byIdx[shard->shardIdx] = shard;
+
+		if (shard->file.recsCnt != shard->existingCnt + shard->recordsCnt) {
+			printf("verify: %s: has %"PRIu64" records, manifest says %"PRIu64
+			       " (%"PRIu64" existing + %"PRIu64" written)\n",
+			       shard->file.filePath, shard->file.recsCnt,
+			       shard->existingCnt + shard->recordsCnt,
+			       shard->existingCnt, shard->recordsCnt);
+			ok = false;
+		}
+	}
+	for (int i = 0; i < shardCnt; i++) {
+		if (byIdx[i] == NULL) {
+			printf("verify: shard %d/%d is missing\n", i, shardCnt);
+			ok = false;
+		}
+	}
+	if (!ok) {
+		free(byIdx);
+		return false;
+	}
+
+	// same prime files everywhere, and the slices tile each file exactly
+	const PrimeStats_Shard_st* first = byIdx[0];
+	for (int i = 0; i < shardCnt; i++) {
+		const PrimeStats_Shard_st* shard = byIdx[i];
+		if (shard->filesCnt != first->filesCnt) {
+			printf("verify: %s: covers %d prime files, shard 0 covers %d\n",
+			       shard->file.filePath, shard->filesCnt, first->filesCnt);
+			ok = false;
+			continue;
+		}
+		for (int f = 0; f < shard->filesCnt; f++) {
+			const PrimeStats_ShardFile_st* file = &shard->files[f];
+			if (   strcmp(file->fileName, first->files[f].fileName)
+			    || file->primeCnt != first->files[f].primeCnt) {
+				printf("verify: %s: prime file %s differs from shard 0's %s\n",
+				       shard->file.filePath, file->fileName, first->files[f].fileName);
+				ok = false;
+				continue;
+			}
+			const uint64_t expectBeg = (i == 0)
+			                         ? 0 : byIdx[i - 1]->files[f].primeEnd;
+			if (file->primeBeg != expectBeg) {
+				printf("verify: %s: gap/overlap at prime %"PRIu64" of %s\n",
+				       shard->file.filePath, expectBeg, file->fileName);
+				ok = false;
+			}
+			if (i == shardCnt - 1 && file->primeEnd != file->primeCnt) {
+				printf("verify: %s: primes %"PRIu64"..%"PRIu64" of %s not covered\n",
+				       shard->file.filePath, file->primeEnd, file->primeCnt,
+				       file->fileName);
+				ok = false;
+			}
+		}
+	}
+
+	free(byIdx);
+	return ok;
+}
+
+//------------------------------------------------------------------------------
+// min-heap of runs on the prime at each run's current position, then on run
+// index so the earliest input's copy of a duplicate comes out first.
+static inline bool
+_runLess(const PrimeStats_MergeRun_st* a, const PrimeStats_MergeRun_st* b)
+{
+	return a->prime < b->prime || (a->prime == b->prime && a->idx < b->idx);
+}
+
+void
+_heapDown(PrimeStats_MergeRun_st* heap, const int heapCnt, int i)
+{
+	for (;;) {
+		int min = i;
+		const int l = 2 * i + 1;
+		const int r = 2 * i + 2;
+		if (l < heapCnt && _runLess(&heap[l], &heap[min])) { min = l; }
+		if (r < heapCnt && _runLess(&heap[r], &heap[min])) { min = r; }
+		if (min == i) { return; }
+		PrimeStats_MergeRun_st tmp = heap[i];
+		heap[i]   = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+//------------------------------------------------------------------------------
+PrimeStats_MergeRun_st*
+mergeRunsFind(const PrimeStats_Shard_st* shards, const int shardsCnt,
+              int* runsCnt)
+{
+	int runsCap = 64;
+	*runsCnt = 0;
+	PrimeStats_MergeRun_st* runs = malloc(runsCap * sizeof(*runs));
+	for (int i = 0; i < shardsCnt; i++)
+	{
+		const PrimeStats_File_st* file = &shards[i].file;
+		uint64_t beg = 0;
+		for (uint64_t j = 1; j <= file->recsCnt; j++) {
+			if (   j < file->recsCnt
+			    &&   PrimeStats_RecPrime(PrimeStats_FileRec(file, j))
+			       > PrimeStats_RecPrime(PrimeStats_FileRec(file, j - 1))) {
+				continue;
+			}
+			if (*runsCnt == runsCap) {
+				runsCap *= 2;
+				runs = realloc(runs, runsCap * sizeof(*runs));
+			}
+			runs[*runsCnt].pos   = PrimeStats_FileRec(file, beg);
+			runs[*runsCnt].end   = PrimeStats_FileRec(file, j);
+			runs[*runsCnt].prime = PrimeStats_RecPrime(runs[*runsCnt].pos);
+			runs[*runsCnt].idx   = *runsCnt;
+			(*runsCnt)++;
+			beg = j;
+		}
+	}
+	return runs;
+}
+
+//------------------------------------------------------------------------------
+void
+printHelpAndExit()
+{
+	printf(
+		"\n"
+		"PrimeStats.Merge: merge shard outputs into one file sorted by prime\n"
+		"options:\n"
+		"\n\t" "-h: help"
+		"\n\t" "-o: output file : file_out_data"
+		"\n\t" "-n: no verify   : skip the .shard coverage check"
+		"\n\n"
+		"eg:\n"
+		"\n./PrimeStats.Merge"
+		"\n\t-o \"./PrimeStats.data\" "
+		"\n\t./PrimeStats.0.data ./PrimeStats.1.data ./PrimeStats.2.data"
+		"\n\n"
+	);
+	exit(1);
+}
+
+void
+cliOptsToCfg(int argc, char *argv[])
+{
+  int  opt;
+  bool hasErr = false;
+
+  while ((opt = getopt(argc, argv, ":ho:n")) != -1)
+  {
+    switch(opt)
+    {
+			case 'h':
+		    printHelpAndExit();
+		    break;
+			case 'o':
+		    file_out_data = optarg;
+		    break;
+			case 'n':
+		    no_verify = true;
+		    break;
+			default:
+				hasErr = true;
+		    break;
+    }
+  }
+
+	if (file_out_data == NULL) {
+		hasErr = true;
+	}
+	if (optind >= argc) {
+		hasErr = true;
+	}
+
+  if (hasErr) {
+  	printf("invalid options given.\n");
+    printHelpAndExit();
+  }
+}
+
+
+//==============================================================================
+int
+main(int argc, char *argv[])
+{
+	cliOptsToCfg(argc, argv);
+
+	const int shardsCnt = argc - optind;
+	PrimeStats_Shard_st* shards = calloc(shardsCnt, sizeof(*shards));
+	for (int i = 0; i < shardsCnt; i++) {
+		shardOpen(&shards[i], argv[optind + i]);
+		printf("input: %s: %"PRIu64" records\n",
+		       shards[i].file.filePath, shards[i].file.recsCnt);
+		if (!KeyLens_Equal(&shards[i].file.lens, &shards[0].file.lens)) {
+			printf("%s: key lengths differ from %s\n",
+			       shards[i].file.filePath, shards[0].file.filePath);
+			exit(1);
+		}
+	}
+	fflush(stdout);
+
+	const PrimeStats_KeyLens_st* lens    = &shards[0].file.lens;
+	const size_t                 recSize = shards[0].file.recSize;
+
+	if (!no_verify) {
+		if (!shardsVerify(shards, shardsCnt)) {
+			printf("coverage check failed, not merging (-n to force)\n");
+			exit(1);
+		}
+		printf("coverage: OK, %d of %d shards\n", shardsCnt, shards[0].shardCnt);
+
+		uint64_t skippedCnt = 0;
+		for (int i = 0; i < shardsCnt; i++) {
+			skippedCnt += shards[i].skippedCnt;
+		}
+		if (skippedCnt) {
+			printf("coverage: %"PRIu64" primes were skipped as done; they're in"
+			       " the inputs' existing records if resumed, else only in the"
+			       " earlier runs' data\n", skippedCnt);
+		}
+	}
+
+	//--------------------------------------------------------------------
+	int runsCnt = 0;
+	PrimeStats_MergeRun_st* runs = mergeRunsFind(shards, shardsCnt, &runsCnt);
+	for (int i = runsCnt / 2 - 1; i >= 0; i--) {
+		_heapDown(runs, runsCnt, i);
+	}
+	printf("runs : %d\n", runsCnt);
+	fflush(stdout);
+
+	// truncating an input that's still mapped would SIGBUS the merge
+	char tmpPath[1024 + 8];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", file_out_data);
+	FILE* fp = fopen(tmpPath, "w");
+	if (fp == NULL) {
+		printf("can't open %s: %s\n", tmpPath, strerror(errno));
+		exit(1);
+	}
+	setvbuf(fp, NULL, _IOFBF, PS_MERGE_OUT_BUF);
+
+	PrimeStats_FileHdr_st hdr;
+	PrimeStats_FileHdrInit(&hdr, lens);
+	if (1 != fwrite(&hdr, sizeof(hdr), 1, fp)) {
+		printf("write failed: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	struct timespec timeStart = timerStart();
+
+	uint64_t outCnt    = 0;
+	uint64_t dupCnt    = 0;
+	uint64_t primeLast = 0;
+	int      heapCnt   = runsCnt;
+	while (heapCnt)
+	{
+		const uint64_t prime = runs[0].prime;
+		if (outCnt && prime == primeLast) {
+			dupCnt++;
+		} else {
+			if (1 != fwrite(runs[0].pos, recSize, 1, fp)) {
+				printf("write failed: %s\n", strerror(errno));
+				exit(1);
+			}
+			primeLast = prime;
+			outCnt++;
+		}
+
+		runs[0].pos += recSize;
+		if (runs[0].pos == runs[0].end) {
+			runs[0] = runs[--heapCnt];
+		} else {
+			runs[0].prime = PrimeStats_RecPrime(runs[0].pos);
+		}
+		_heapDown(runs, heapCnt, 0);
+	}
+
+	if (fclose(fp) != 0) {
+		printf("write failed: %s\n", strerror(errno));
+		exit(1);
+	}
+	if (rename(tmpPath, file_out_data) != 0) {
+		printf("rename %s -> %s failed: %s\n",
+		       tmpPath, file_out_data, strerror(errno));
+		exit(1);
+	}
+
+	uint64_t timeDiff = timerEnd(timeStart);
+	printf("out  : %"PRIu64" records, %"PRIu64" duplicates dropped\n",
+	       outCnt, dupCnt);
+	printf("time : ");
+	printU64WithCommas(timeDiff);
+	printf(" ns\n");
+
+	return 0;
+}
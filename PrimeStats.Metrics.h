@@ -0,0 +1,283 @@
+#ifndef _PrimeStats_Metrics_h_
+#define _PrimeStats_Metrics_h_
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+//
+// progress/metrics surface for long runs.
+//
+// every worker owns one cache-line sized slot of counters and is the only
+// writer to it, so updating a counter is a relaxed load + store: no locks,
+// no shared cache lines, nothing for the hot loop to wait on.
+//
+// a separate exporter thread wakes every PS_METRICS_INTERVAL_SEC, sums the
+// slots and rewrites a prometheus text file (write to .tmp, then rename, so
+// a scraper never sees a partial file).
+//
+
+#define PS_METRICS_WORKERS_MAX  256
+#define PS_METRICS_INTERVAL_SEC 10
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_MetricsWorker_st {
+	_Atomic uint64_t primesDone;     // primes fully evaluated
+	_Atomic uint64_t primesSkipped;  // already in the done-set (-d), not evaluated
+	_Atomic uint64_t keysDone;       // keys hashed (not counting avalanche)
+	_Atomic uint64_t bytesWritten;   // bytes appended to file_out_data
+	_Atomic uint64_t batchDepth;     // records waiting in the batch buffer
+	_Atomic int64_t  fileIdx;        // current prime file, -1 when idle
+} __attribute__((aligned(64))) PrimeStats_MetricsWorker_st;
+
+typedef struct PrimeStats_Metrics_st {
+	PrimeStats_MetricsWorker_st worker[PS_METRICS_WORKERS_MAX];
+	int                         workerCnt;
+
+	uint64_t           primesTotal; // for eta; 0 if unknown
+	const char* const* fileNames;   // indexed by worker[].fileIdx
+	int                filesCnt;
+
+	const char*        filePath;
+	struct timespec    timeStart;
+	pthread_t          thread;
+	pthread_mutex_t    lock;
+	pthread_cond_t     cond;
+	bool               stop;
+
+	// exporter-only state, for the per-interval rates
+	uint64_t           lastNs;
+	uint64_t           lastPrimes;
+	uint64_t           lastKeys;
+} PrimeStats_Metrics_st;
+
+
+//------------------------------------------------------------------------------
+// single writer per slot: no need for an atomic rmw.
+static inline void
+_metricsAdd(_Atomic uint64_t* cnt, const uint64_t val)
+{
+	const uint64_t cur = atomic_load_explicit(cnt, memory_order_relaxed);
+	atomic_store_explicit(cnt, cur + val, memory_order_relaxed);
+}
+
+static inline void
+_metricsSet(_Atomic uint64_t* cnt, const uint64_t val)
+{
+	atomic_store_explicit(cnt, val, memory_order_relaxed);
+}
+
+static inline uint64_t
+_metricsGet(_Atomic uint64_t* cnt)
+{
+	return atomic_load_explicit(cnt, memory_order_relaxed);
+}
+
+static inline void
+Metrics_SetFile(PrimeStats_MetricsWorker_st* w, const int64_t fileIdx)
+{
+	atomic_store_explicit(&w->fileIdx, fileIdx, memory_order_relaxed);
+}
+
+
+//------------------------------------------------------------------------------
+static uint64_t
+_metricsNs(const PrimeStats_Metrics_st* m)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - m->timeStart.tv_sec) * (uint64_t)1e9
+	     + (now.tv_nsec - m->timeStart.tv_nsec);
+}
+
+// prometheus label values only need \, " and newline escaped.
+static void
+_metricsLabel(FILE* fp, const char* str)
+{
+	for (; *str; str++) {
+		if      (*str == '\\') { fputs("\\\\", fp); }
+		else if (*str == '"' ) { fputs("\\\"", fp); }
+		else if (*str == '\n') { fputs("\\n",  fp); }
+		else                   { fputc(*str,   fp); }
+	}
+}
+
+static void
+_metricsHeader(FILE* fp, const char* name, const char* type, const char* help)
+{
+	fprintf(fp, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+//------------------------------------------------------------------------------
+void
+Metrics_Export(PrimeStats_Metrics_st* m)
+{
+	uint64_t primes = 0, skipped = 0, keys = 0, bytes = 0, depth = 0;
+	for (int i = 0; i < m->workerCnt; i++) {
+		primes   += _metricsGet(&m->worker[i].primesDone);
+		skipped  += _metricsGet(&m->worker[i].primesSkipped);
+		keys     += _metricsGet(&m->worker[i].keysDone);
+		bytes    += _metricsGet(&m->worker[i].bytesWritten);
+		depth    += _metricsGet(&m->worker[i].batchDepth);
+	}
+
+	const uint64_t ns     = _metricsNs(m);
+	const uint64_t nsDiff = ns - m->lastNs;
+	const double   secs   = ns / 1e9;
+	double primesPerSec = 0;
+	double keysPerSec   = 0;
+	if (nsDiff) {
+		primesPerSec = (primes - m->lastPrimes) / (nsDiff / 1e9);
+		keysPerSec   = (keys   - m->lastKeys  ) / (nsDiff / 1e9);
+	}
+	m->lastNs     = ns;
+	m->lastPrimes = primes;
+	m->lastKeys   = keys;
+
+	// eta is from the whole-run average; the interval rate is too noisy.
+	double eta = -1;
+	const uint64_t handled = primes + skipped;
+	if (m->primesTotal && primes && secs > 0) {
+		const uint64_t left = m->primesTotal > handled
+		                    ? m->primesTotal - handled : 0;
+		eta = left / (primes / secs);
+	}
+
+	char tmpPath[1024];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", m->filePath);
+	FILE* fp = fopen(tmpPath, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Metrics_Export(): can't open %s\n", tmpPath);
+		return;
+	}
+
+	_metricsHeader(fp, "primestats_uptime_seconds", "gauge",
+	               "Seconds since the sweep started.");
+	fprintf(fp, "primestats_uptime_seconds %.3f\n", secs);
+	_metricsHeader(fp, "primestats_primes_total", "counter",
+	               "Primes evaluated.");
+	fprintf(fp, "primestats_primes_total %"PRIu64"\n", primes);
+	_metricsHeader(fp, "primestats_primes_skipped_total", "counter",
+	               "Primes skipped because a -d done file already has them.");
+	fprintf(fp, "primestats_primes_skipped_total %"PRIu64"\n", skipped);
+	_metricsHeader(fp, "primestats_primes_expected", "gauge",
+	               "Primes in the input set, 0 if unknown.");
+	fprintf(fp, "primestats_primes_expected %"PRIu64"\n", m->primesTotal);
+	_metricsHeader(fp, "primestats_primes_per_second", "gauge",
+	               "Primes evaluated per second over the last interval.");
+	fprintf(fp, "primestats_primes_per_second %.3f\n", primesPerSec);
+	_metricsHeader(fp, "primestats_keys_total", "counter",
+	               "Keys hashed.");
+	fprintf(fp, "primestats_keys_total %"PRIu64"\n", keys);
+	_metricsHeader(fp, "primestats_keys_per_second", "gauge",
+	               "Keys hashed per second over the last interval.");
+	fprintf(fp, "primestats_keys_per_second %.3f\n", keysPerSec);
+	_metricsHeader(fp, "primestats_bytes_written_total", "counter",
+	               "Bytes appended to the output data file.");
+	fprintf(fp, "primestats_bytes_written_total %"PRIu64"\n", bytes);
+	_metricsHeader(fp, "primestats_batch_depth", "gauge",
+	               "Records buffered and not yet written, all workers.");
+	fprintf(fp, "primestats_batch_depth %"PRIu64"\n", depth);
+	_metricsHeader(fp, "primestats_eta_seconds", "gauge",
+	               "Estimated seconds left, -1 if unknown.");
+	fprintf(fp, "primestats_eta_seconds %.0f\n", eta);
+
+	_metricsHeader(fp, "primestats_worker_primes_total", "counter",
+	               "Primes evaluated, per worker.");
+	for (int i = 0; i < m->workerCnt; i++) {
+		fprintf(fp, "primestats_worker_primes_total{worker=\"%d\"} %"PRIu64"\n",
+		        i, _metricsGet(&m->worker[i].primesDone));
+	}
+	_metricsHeader(fp, "primestats_worker_batch_depth", "gauge",
+	               "Records buffered and not yet written, per worker.");
+	for (int i = 0; i < m->workerCnt; i++) {
+		fprintf(fp, "primestats_worker_batch_depth{worker=\"%d\"} %"PRIu64"\n",
+		        i, _metricsGet(&m->worker[i].batchDepth));
+	}
+	_metricsHeader(fp, "primestats_worker_prime_file", "gauge",
+	               "Prime file a worker is on; the value is the file index.");
+	for (int i = 0; i < m->workerCnt; i++) {
+		const int64_t fileIdx = atomic_load_explicit(&m->worker[i].fileIdx,
+		                                             memory_order_relaxed);
+		if (fileIdx < 0 || fileIdx >= m->filesCnt) { continue; }
+		fprintf(fp, "primestats_worker_prime_file{worker=\"%d\",file=\"", i);
+		_metricsLabel(fp, m->fileNames[fileIdx]);
+		fprintf(fp, "\"} %"PRId64"\n", fileIdx);
+	}
+
+	if (fclose(fp) != 0 || rename(tmpPath, m->filePath) != 0) {
+		fprintf(stderr, "Metrics_Export(): can't write %s\n", m->filePath);
+	}
+}
+
+//------------------------------------------------------------------------------
+static void*
+_metricsThread(void* arg)
+{
+	PrimeStats_Metrics_st* m = arg;
+
+	pthread_mutex_lock(&m->lock);
+	while (!m->stop) {
+		struct timespec wake;
+		clock_gettime(CLOCK_REALTIME, &wake);
+		wake.tv_sec += PS_METRICS_INTERVAL_SEC;
+		pthread_cond_timedwait(&m->cond, &m->lock, &wake);
+		Metrics_Export(m);
+	}
+	pthread_mutex_unlock(&m->lock);
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// filePath may be NULL, in which case the counters are still kept (they're
+// cheap) but nothing is exported.
+void
+Metrics_Init(PrimeStats_Metrics_st* m, const char* filePath, int workerCnt)
+{
+	memset(m, 0, sizeof(*m));
+	if (workerCnt > PS_METRICS_WORKERS_MAX) {
+		workerCnt = PS_METRICS_WORKERS_MAX;
+	}
+	m->workerCnt = workerCnt;
+	m->filePath  = filePath;
+	for (int i = 0; i < PS_METRICS_WORKERS_MAX; i++) {
+		Metrics_SetFile(&m->worker[i], -1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &m->timeStart);
+}
+
+void
+Metrics_Start(PrimeStats_Metrics_st* m)
+{
+	if (m->filePath == NULL) { return; }
+
+	pthread_mutex_init(&m->lock, NULL);
+	pthread_cond_init (&m->cond, NULL);
+	if (pthread_create(&m->thread, NULL, _metricsThread, m) != 0) {
+		printf("Metrics_Start(): pthread_create failed\n");
+		exit(1);
+	}
+}
+
+// wakes the exporter for one last export and waits for it.
+void
+Metrics_Stop(PrimeStats_Metrics_st* m)
+{
+	if (m->filePath == NULL) { return; }
+
+	pthread_mutex_lock(&m->lock);
+	m->stop = true;
+	pthread_cond_signal(&m->cond);
+	pthread_mutex_unlock(&m->lock);
+	pthread_join(m->thread, NULL);
+}
+
+
+#endif // _PrimeStats_Metrics_h_
@@ -0,0 +1,192 @@
+#ifndef _PrimeStats_Numa_h_
+#define _PrimeStats_Numa_h_
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+// numa topology and worker placement, straight from sysfs so there's no
+// libnuma dependency.
+//
+// memory placement relies on linux's default first-touch policy: a page
+// lands on the node of the cpu that first writes it. so anything a worker
+// allocates *after* it has been pinned, and writes itself, is node local.
+// Numa_AllocLocal() just makes that explicit.
+//
+// only cpus in the process' affinity mask are used, so taskset/cgroups still
+// decide what we're allowed to run on.
+//
+
+#define PS_NUMA_NODES_MAX 64
+#define PS_NUMA_SYSFS     "/sys/devices/system/node"
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_NumaNode_st {
+	int  node;     // sysfs node number
+	int* cpus;
+	int  cpusCnt;
+} PrimeStats_NumaNode_st;
+
+typedef struct PrimeStats_Numa_st {
+	PrimeStats_NumaNode_st nodes[PS_NUMA_NODES_MAX];
+	int                    nodesCnt;
+	int                    cpusCnt;
+	bool                   fromSysfs; // false: sysfs missing, one fake node
+} PrimeStats_Numa_st;
+
+
+//------------------------------------------------------------------------------
+// parses a sysfs cpulist ("0-3,8-11") into cpus[], skipping any cpu not in
+// allowed. returns the number of cpus kept.
+int
+_numaCpuListParse(const char* list, const cpu_set_t* allowed,
+                  int* cpus, const int cpusMax)
+{
+	int cnt = 0;
+	const char* pos = list;
+	while (*pos && *pos != '\n')
+	{
+		char* end;
+		const long beg = strtol(pos, &end, 10);
+		long       fin = beg;
+		if (end == pos) { break; }
+		pos = end;
+		if (*pos == '-') {
+			fin = strtol(pos + 1, &end, 10);
+			pos = end;
+		}
+		for (long cpu = beg; cpu <= fin && cnt < cpusMax; cpu++) {
+			if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, allowed)) {
+				cpus[cnt++] = cpu;
+			}
+		}
+		if (*pos == ',') { pos++; }
+	}
+	return cnt;
+}
+
+//------------------------------------------------------------------------------
+void
+Numa_Init(PrimeStats_Numa_st* numa)
+{
+	memset(numa, 0, sizeof(*numa));
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		for (int i = 0; i < CPU_SETSIZE; i++) { CPU_SET(i, &allowed); }
+	}
+
+	for (int node = 0; node < PS_NUMA_NODES_MAX; node++)
+	{
+		char path[256];
+		snprintf(path, sizeof(path), PS_NUMA_SYSFS"/node%d/cpulist", node);
+		FILE* fp = fopen(path, "r");
+		if (fp == NULL) {
+			continue; // node numbers can have holes
+		}
+		char list[4096] = {0};
+		if (fgets(list, sizeof(list), fp) == NULL) { list[0] = 0; }
+		fclose(fp);
+
+		int* cpus = malloc(CPU_SETSIZE * sizeof(*cpus));
+		const int cpusCnt = _numaCpuListParse(list, &allowed, cpus, CPU_SETSIZE);
+		if (cpusCnt == 0) {
+			// memory-only node, or nothing we may run on
+			free(cpus);
+			continue;
+		}
+		PrimeStats_NumaNode_st* n = &numa->nodes[numa->nodesCnt++];
+		n->node    = node;
+		n->cpus    = cpus;
+		n->cpusCnt = cpusCnt;
+		numa->cpusCnt += cpusCnt;
+		numa->fromSysfs = true;
+	}
+
+	if (numa->nodesCnt == 0) {
+		PrimeStats_NumaNode_st* n = &numa->nodes[numa->nodesCnt++];
+		n->node = 0;
+		n->cpus = malloc(CPU_SETSIZE * sizeof(*n->cpus));
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &allowed)) { n->cpus[n->cpusCnt++] = cpu; }
+		}
+		numa->cpusCnt = n->cpusCnt;
+	}
+}
+
+//------------------------------------------------------------------------------
+void
+Numa_Print(const PrimeStats_Numa_st* numa)
+{
+	printf("numa topology%s:\n",
+	       numa->fromSysfs ? "" : " (no sysfs info, assuming one node)");
+	printf("\tnodes : %d\n", numa->nodesCnt);
+	printf("\tcpus  : %d\n", numa->cpusCnt);
+	for (int i = 0; i < numa->nodesCnt; i++) {
+		const PrimeStats_NumaNode_st* n = &numa->nodes[i];
+		printf("\tnode %d: %d cpus:", n->node, n->cpusCnt);
+		for (int c = 0; c < n->cpusCnt; c++) {
+			printf(" %d", n->cpus[c]);
+		}
+		printf("\n");
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+//------------------------------------------------------------------------------
+// workers are dealt round-robin across nodes, so any worker count splits as
+// evenly as possible between sockets. returns the index into numa->nodes[]
+// and sets *cpu.
+int
+Numa_WorkerPlace(const PrimeStats_Numa_st* numa, const int workerIdx, int* cpu)
+{
+	const int nodeIdx = workerIdx % numa->nodesCnt;
+	const PrimeStats_NumaNode_st* n = &numa->nodes[nodeIdx];
+	*cpu = n->cpus[(workerIdx / numa->nodesCnt) % n->cpusCnt];
+	return nodeIdx;
+}
+
+bool
+Numa_PinSelf(const int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+//------------------------------------------------------------------------------
+// zeroed memory, first touched (and so placed) by the calling thread.
+void*
+Numa_AllocLocal(const size_t size)
+{
+	void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+	                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		printf("Numa_AllocLocal(): mmap failed: %s\n", strerror(errno));
+		exit(1);
+	}
+	// anonymous pages aren't backed until written; write one byte a page.
+	const long pageSize = sysconf(_SC_PAGESIZE);
+	for (size_t off = 0; off < size; off += pageSize) {
+		((volatile char*)mem)[off] = 0;
+	}
+	return mem;
+}
+
+
+#endif // _PrimeStats_Numa_h_
@@ -11,30 +11,138 @@
 
 #include "PrimeStats.h"
 #include "PrimeStats.Util.h"
+#include "PrimeStats.File.h"
+#include "PrimeStats.Export.h"
 
 #define  FILE_OUT_DATA "./PrimeStats.data"
 
 
+//==============================================================================
+static char*    file_in_data = FILE_OUT_DATA;
+static uint64_t find_prime   = 0;
+static char*    file_out     = NULL;
+static int      threads_cnt  = 0;
+
+static PrimeStats_ExportFmt_e export_fmt = PS_EXPORT_NONE;
+
+
+//------------------------------------------------------------------------------
+void
+printHelpAndExit()
+{
+	printf(
+		"\n"
+		"PrimeStats.Read: filter and print a PrimeStats data file\n"
+		"options:\n"
+		"\n\t" "-h: help"
+		"\n\t" "-f: data file : file_in_data (default "FILE_OUT_DATA")"
+		"\n\t" "-P: prime     : print just this prime (file must be sorted,"
+		" see PrimeStats.Merge)"
+		"\n\t" "-e: export    : csv|json|bin, every record's meta"
+		"\n\t" "-o: out file  : export destination (csv/json default stdout)"
+		"\n\t" "-t: threads   : export threads (default: online cpus)"
+		"\n\n"
+	);
+	exit(1);
+}
+
+void
+cliOptsToCfg(int argc, char *argv[])
+{
+  int  opt;
+  bool hasErr = false;
+
+  while ((opt = getopt(argc, argv, ":hf:P:e:o:t:")) != -1)
+  {
+    switch(opt)
+    {
+			case 'h':
+		    printHelpAndExit();
+		    break;
+			case 'f':
+		    file_in_data = optarg;
+		    break;
+			case 'P':
+		    if (1 != sscanf(optarg, "%"SCNu64, &find_prime)) {
+		    	hasErr = true;
+		    }
+		    break;
+			case 'e':
+		    if      (0 == strcmp(optarg, "csv" )) { export_fmt = PS_EXPORT_CSV;  }
+		    else if (0 == strcmp(optarg, "json")) { export_fmt = PS_EXPORT_JSON; }
+		    else if (0 == strcmp(optarg, "bin" )) { export_fmt = PS_EXPORT_BIN;  }
+		    else                                  { hasErr = true;               }
+		    break;
+			case 'o':
+		    file_out = optarg;
+		    break;
+			case 't':
+		    threads_cnt = atoi(optarg);
+		    break;
+			default:
+				hasErr = true;
+		    break;
+    }
+  }
+
+  if (hasErr || optind < argc) {
+  	printf("invalid options given.\n");
+    printHelpAndExit();
+  }
+}
 
 
 //==============================================================================
 int
-main()
+main(int argc, char *argv[])
 {
-	off_t fileSize = 0;
-	const PrimeStats_st* stats = mmapFileToPtr(FILE_OUT_DATA, &fileSize);
-	const int statsCnt = fileSize / sizeof(*stats);
+	cliOptsToCfg(argc, argv);
+
+	PrimeStats_File_st file;
+	PrimeStats_FileOpen(&file, file_in_data);
+	const int statsCnt = file.recsCnt;
+
+	if (export_fmt != PS_EXPORT_NONE) {
+		if (threads_cnt < 1) {
+			threads_cnt = sysconf(_SC_NPROCESSORS_ONLN);
+		}
+		struct timespec timeStart = timerStart();
+		PrimeStats_Export(file_out, export_fmt, &file, threads_cnt);
+		uint64_t timeDiff = timerEnd(timeStart);
+		// stdout may be the export itself
+		fprintf(stderr, "exported %d records in %.3f s\n",
+		        statsCnt, timeDiff / 1e9);
+		return 0;
+	}
 
-	printf("fileSize: %ld\n", fileSize);
+	printf("fileSize: %ld\n", file.mapSize);
 	printf("statsCnt: %d\n", statsCnt);
-	printf("\n\n");
+	printf("keyLens :");
+	for (int l = 0; l < file.lens.cnt; l++) {
+		printf(" %d", file.lens.len[l]);
+	}
+	printf("\n\n\n");
 	fflush(stdout);
 
+	PrimeStats_st stats;
+	if (find_prime) {
+		const void* found = PrimeStats_Find(file.recs, file.recsCnt, file.recSize,
+		                                    find_prime);
+		if (found == NULL) {
+			printf("prime %"PRIu64" not found\n", find_prime);
+			return 1;
+		}
+		PrimeStats_Unpack(found, file.lens.cnt, &stats);
+		PrimeStatsMeta_PrintChart(&stats, &file.lens);
+		return 0;
+	}
+
 	int outCnt = 100;
 	int loopCnt = 0;
 	for (int i = 0; i < statsCnt; i++)
 	{
 		loopCnt++;
+		const void* rec = PrimeStats_FileRec(&file, i);
 
 		// for (int l = 2; l < 8; l++) {
 		// 	if (   stats->meta.ava[l].pop.avg >= 27
@@ -47,10 +155,13 @@ main()
 		// 	}
 		// }
 
-		for (int l = 6; l < 8; l++) {
-			if (   stats->meta.ava[l].pop.avg >= 15
-			    && stats->meta.ava[l].pop.avg <= 35) {
-				PrimeStatsMeta_PrintChart(&stats[i]);
+		for (int l = 6; l < 8 && l < file.lens.cnt; l++) {
+			const PrimeStats_BitsCntMeta_st* ava
+				= PrimeStats_RecMetaAva(rec, file.lens.cnt, l);
+			if (   ava->pop.avg >= 15
+			    && ava->pop.avg <= 35) {
+				PrimeStats_Unpack(rec, file.lens.cnt, &stats);
+				PrimeStatsMeta_PrintChart(&stats, &file.lens);
 				if (--outCnt == 0) {
 					goto FIN;
 				}
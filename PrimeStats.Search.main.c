@@ -0,0 +1,552 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "PrimeStats.h"
+#include "PrimeStats.Util.h"
+#include "PrimeStats.File.h"
+#include "PrimeStats.Keys.h"
+
+//
+// guided search: instead of sweeping primesieve output in order, start from
+// the best records of an existing data file and look around them.
+//
+// every generation:
+//   - candidates are made by mutating pool members (bit flips, flipped runs,
+//     swapped nibbles), forced odd, and dropped if already seen or not prime
+//     (deterministic 64-bit miller-rabin)
+//   - survivors are evaluated in parallel with the same key files and key
+//     lengths as the input, through PrimeStats_RunKeys/PrimeStatsMeta_Calc
+//   - every evaluated record is appended to the output file, and any that
+//     score better than the worst pool member replaces it
+//
+// the score is a heuristic over the meta, lower is better, see searchScore().
+// progress is reported against process cpu time, as score improvement and
+// pool entries per cpu-hour.
+//
+
+
+//==============================================================================
+static char*    file_in_data  = NULL;
+static char*    file_out_data = NULL;
+static char*    key_files_dir = NULL;
+static int      seeds_cnt     = 16;
+static int      threads_cnt   = 1;
+static int      batch_cnt     = 0;
+static int      gens_cnt      = 0;
+static double   cpu_budget    = 0; // seconds
+static uint64_t rng_state     = 1;
+
+static PrimeStats_Alphabet_st key_alphabet;
+static bool                   key_gen = false;
+
+static const int maxKeysPerFile = 10000; // same as PrimeStats.main
+
+// a generation's records are one allocation and one append, so -b is capped
+// by this over the record size (which depends on the input's key lengths)
+#define PS_SEARCH_BATCH_BYTES_MAX (1ull << 30)
+#define PS_SEARCH_THREADS_MAX     1024
+
+
+//------------------------------------------------------------------------------
+typedef struct PrimeStats_SearchEntry_st {
+	uint64_t prime;
+	double   score;
+} PrimeStats_SearchEntry_st;
+
+typedef struct PrimeStats_SearchJob_st {
+	const PrimeStats_KeyFiles_st* keyFiles;
+	const PrimeStats_KeyLens_st*  lens;
+	const uint64_t*               cands;
+	uint8_t*                      recs;
+	int                           candBeg;
+	int                           candEnd;
+	pthread_t                     thread;
+} PrimeStats_SearchJob_st;
+
+
+//------------------------------------------------------------------------------
+// splitmix64
+static inline uint64_t
+_rng()
+{
+	uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+//------------------------------------------------------------------------------
+static inline uint64_t
+_mulMod(const uint64_t a, const uint64_t b, const uint64_t m)
+{
+	return (unsigned __int128)a * b % m;
+}
+
+static uint64_t
+_powMod(uint64_t a, uint64_t e, const uint64_t m)
+{
+	uint64_t r = 1;
+	while (e) {
+		if (e & 1) { r = _mulMod(r, a, m); }
+		a = _mulMod(a, a, m);
+		e >>= 1;
+	}
+	return r;
+}
+
+// deterministic for all 64-bit n with these 7 bases (jim sinclair's set).
+bool
+isPrime64(const uint64_t n)
+{
+	static const uint64_t small[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+	static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504,
+	                                  1795265022 };
+	if (n < 2) { return false; }
+	for (size_t i = 0; i < sizeof(small) / sizeof(small[0]); i++) {
+		if (n % small[i] == 0) { return n == small[i]; }
+	}
+
+	const int      s = __builtin_ctzll(n - 1);
+	const uint64_t d = (n - 1) >> s;
+	for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+		const uint64_t a = bases[i] % n;
+		if (a == 0) { continue; }
+		uint64_t x = _powMod(a, d, n);
+		if (x == 1 || x == n - 1) { continue; }
+		int r = 1;
+		for (; r < s; r++) {
+			x = _mulMod(x, x, n);
+			if (x == n - 1) { break; }
+		}
+		if (r == s) { return false; }
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// open addressing set of every prime seen: the input, the output, and every
+// candidate generated. 0 marks an empty slot (0 is never a candidate).
+static uint64_t* seen;
+static uint64_t  seenCap;
+static uint64_t  seenCnt;
+
+static inline uint64_t
+_seenHash(const uint64_t prime)
+{
+	return (prime * 0x9e3779b97f4a7c15ull) >> 17;
+}
+
+bool searchSeenAdd(const uint64_t prime);
+
+void
+_seenGrow()
+{
+	uint64_t* old    = seen;
+	uint64_t  oldCap = seenCap;
+	seenCap = seenCap ? seenCap * 2 : (1 << 16);
+	seen    = calloc(seenCap, sizeof(*seen));
+	seenCnt = 0;
+	for (uint64_t i = 0; i < oldCap; i++) {
+		if (old[i]) { searchSeenAdd(old[i]); }
+	}
+	free(old);
+}
+
+// false if it was already there
+bool
+searchSeenAdd(const uint64_t prime)
+{
+	if ((seenCnt + 1) * 2 > seenCap) {
+		_seenGrow();
+	}
+	uint64_t i = _seenHash(prime) & (seenCap - 1);
+	while (seen[i]) {
+		if (seen[i] == prime) { return false; }
+		i = (i + 1) & (seenCap - 1);
+	}
+	seen[i] = prime;
+	seenCnt++;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// lower is better. per key length:
+//   - ava.pop.avg off from 33: an ideal hash flips half of the 64 output bits
+//     per input bit flip, and pop.sum counts popcount + 1.
+//   - ava.bit.gap / ava.cnt: how unevenly the output bits flip.
+//   - bits.bit.gap / bits.cnt: how unevenly the output bits are set.
+// the two gap terms are scaled by 64 so all three are in output bits.
+double
+searchScore(const void* rec, const int slotsCnt)
+{
+	double score = 0;
+	for (int slot = 0; slot < slotsCnt; slot++) {
+		const PrimeStats_BitsCntMeta_st* bits
+			= PrimeStats_RecMetaBits(rec, slotsCnt, slot);
+		const PrimeStats_BitsCntMeta_st* ava
+			= PrimeStats_RecMetaAva (rec, slotsCnt, slot);
+		if (bits->cnt == 0 || ava->cnt == 0) { continue; }
+		score += fabs((double)ava->pop.avg - 33);
+		score += 64.0 * ava->bit.gap  / ava->cnt;
+		score += 64.0 * bits->bit.gap / bits->cnt;
+	}
+	return score;
+}
+
+int
+_entryCmp(const void* a, const void* b)
+{
+	const double x = ((const PrimeStats_SearchEntry_st*)a)->score;
+	const double y = ((const PrimeStats_SearchEntry_st*)b)->score;
+	return (x > y) - (x < y);
+}
+
+// the pool is kept sorted, best first. returns true if entry got in.
+bool
+searchPoolOffer(PrimeStats_SearchEntry_st* pool, int* poolCnt,
+                const PrimeStats_SearchEntry_st entry)
+{
+	int i = *poolCnt;
+	if (i == seeds_cnt) {
+		if (entry.score >= pool[i - 1].score) { return false; }
+		i--;
+	} else {
+		(*poolCnt)++;
+	}
+	for (; i > 0 && pool[i - 1].score > entry.score; i--) {
+		pool[i] = pool[i - 1];
+	}
+	pool[i] = entry;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+uint64_t
+searchMutate(uint64_t prime)
+{
+	const uint64_t r = _rng();
+	switch (r & 3)
+	{
+		case 0: // one bit
+			prime ^= 1ull << ((r >> 8) & 63);
+			break;
+		case 1: // two bits
+			prime ^= 1ull << ((r >> 8)  & 63);
+			prime ^= 1ull << ((r >> 16) & 63);
+			break;
+		case 2: { // a run of 2..8 adjacent bits
+			const int len = 2 + ((r >> 8) % 7);
+			const int off = (r >> 16) % (65 - len);
+			prime ^= ((1ull << len) - 1) << off;
+			break;
+		}
+		case 3: { // swap two nibbles
+			const int a = ((r >> 8)  & 15) * 4;
+			const int b = ((r >> 16) & 15) * 4;
+			const uint64_t x = ((prime >> a) ^ (prime >> b)) & 0xf;
+			prime ^= (x << a) | (x << b);
+			break;
+		}
+	}
+	return prime | 1;
+}
+
+//------------------------------------------------------------------------------
+void*
+_searchEvalThread(void* arg)
+{
+	PrimeStats_SearchJob_st* job = arg;
+	const size_t   recSize = PrimeStats_RecSize(job->lens->cnt);
+	PrimeStats_st* stats   = calloc(1, sizeof(*stats));
+	for (int i = job->candBeg; i < job->candEnd; i++) {
+		PrimeStats_Init(stats, job->cands[i]);
+		PrimeStats_RunKeyFiles(stats, job->keyFiles, maxKeysPerFile);
+		PrimeStatsMeta_Calc(stats, job->lens->cnt);
+		PrimeStats_Pack(stats, job->lens->cnt, job->recs + i * recSize);
+	}
+	free(stats);
+	return NULL;
+}
+
+void
+searchEval(const PrimeStats_KeyFiles_st* keyFiles,
+           const PrimeStats_KeyLens_st*  lens,
+           const uint64_t* cands, const int candsCnt, uint8_t* recs)
+{
+	PrimeStats_SearchJob_st* jobs = calloc(threads_cnt, sizeof(*jobs));
+	for (int t = 0; t < threads_cnt; t++) {
+		jobs[t].keyFiles = keyFiles;
+		jobs[t].lens     = lens;
+		jobs[t].cands    = cands;
+		jobs[t].recs     = recs;
+		jobs[t].candBeg  = (uint64_t)candsCnt *  t      / threads_cnt;
+		jobs[t].candEnd  = (uint64_t)candsCnt * (t + 1) / threads_cnt;
+		if (pthread_create(&jobs[t].thread, NULL, _searchEvalThread, &jobs[t])) {
+			printf("pthread_create failed\n");
+			exit(1);
+		}
+	}
+	for (int t = 0; t < threads_cnt; t++) {
+		pthread_join(jobs[t].thread, NULL);
+	}
+	free(jobs);
+}
+
+//------------------------------------------------------------------------------
+double
+cpuSeconds()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+//------------------------------------------------------------------------------
+void
+printHelpAndExit()
+{
+	printf(
+		"\n"
+		"PrimeStats.Search: mutate the best primes of a data file to find better ones\n"
+		"options:\n"
+		"\n\t" "-h: help"
+		"\n\t" "-f: data file   : file_in_data, seeds and key lengths come from here"
+		"\n\t" "-o: output file : file_out_data, every evaluated record is appended"
+		"\n\t" "-k: keys dir    : key_files_dir"
+		"\n\t" "-n: seeds       : pool size (default 16)"
+		"\n\t" "-t: threads     : threads_cnt (default 1)"
+		"\n\t" "-b: batch       : candidates per generation (default threads * 32,"
+		" at most 1gb of records)"
+		"\n\t" "-g: generations : stop after this many"
+		"\n\t" "-c: cpu seconds : stop after this much cpu time (all threads)"
+		"\n\t" "-r: rng seed    : (default 1)"
+		"\n\t" "-a: alphabet    : all|print|alnum, generated short keys (as PrimeStats.main)"
+		"\n\n"
+		"eg:\n"
+		"\n./PrimeStats.Search"
+		"\n\t-f \"./PrimeStats.data\" -o \"./PrimeStats.search.data\""
+		"\n\t-k \"/media/src/o/libo/src/Hash/\" -t 16 -c 36000"
+		"\n\n"
+	);
+	exit(1);
+}
+
+void
+cliOptsToCfg(int argc, char *argv[])
+{
+  int  opt;
+  bool hasErr = false;
+
+  while ((opt = getopt(argc, argv, ":hf:o:k:n:t:b:g:c:r:a:")) != -1)
+  {
+    switch(opt)
+    {
+			case 'h':
+		    printHelpAndExit();
+		    break;
+			case 'f':
+		    file_in_data = optarg;
+		    break;
+			case 'o':
+		    file_out_data = optarg;
+		    break;
+			case 'k':
+		    key_files_dir = optarg;
+		    break;
+			case 'n':
+		    seeds_cnt = atoi(optarg);
+		    break;
+			case 't':
+		    threads_cnt = atoi(optarg);
+		    break;
+			case 'b':
+		    batch_cnt = atoi(optarg);
+		    break;
+			case 'g':
+		    gens_cnt = atoi(optarg);
+		    break;
+			case 'c':
+		    cpu_budget = atof(optarg);
+		    break;
+			case 'r':
+		    rng_state = strtoull(optarg, NULL, 10);
+		    break;
+			case 'a':
+		    if (!Alphabet_Parse(&key_alphabet, optarg)) {
+		    	hasErr = true;
+		    }
+		    key_gen = true;
+		    break;
+			default:
+				hasErr = true;
+		    break;
+    }
+  }
+
+	if (optind < argc) {
+		hasErr = true;
+	}
+	if (file_in_data == NULL || file_out_data == NULL) {
+		hasErr = true;
+	}
+	if (seeds_cnt < 1 || threads_cnt < 1 || threads_cnt > PS_SEARCH_THREADS_MAX
+	    || batch_cnt < 0) {
+		hasErr = true;
+	}
+	if (gens_cnt <= 0 && cpu_budget <= 0) {
+		hasErr = true; // would never stop
+	}
+
+  if (hasErr) {
+  	printf("invalid options given.\n");
+    printHelpAndExit();
+  }
+}
+
+
+//==============================================================================
+int
+main(int argc, char *argv[])
+{
+	cliOptsToCfg(argc, argv);
+
+	PrimeStats_File_st file;
+	PrimeStats_FileOpen(&file, file_in_data);
+	if (file.recsCnt == 0) {
+		printf("%s: no records to seed from\n", file_in_data);
+		exit(1);
+	}
+	const PrimeStats_KeyLens_st  fileLens = file.lens; // outlives the mapping
+	const PrimeStats_KeyLens_st* lens     = &fileLens;
+	const size_t                 recSize  = file.recSize;
+
+	const int batchMax = PS_SEARCH_BATCH_BYTES_MAX / recSize;
+	if (batch_cnt == 0) {
+		batch_cnt = threads_cnt * 32 < batchMax ? threads_cnt * 32 : batchMax;
+	}
+	if (batch_cnt > batchMax) {
+		printf("-b %d: at most %d candidates per generation with %zu byte records\n",
+		       batch_cnt, batchMax, recSize);
+		exit(1);
+	}
+
+	PrimeStats_KeyFiles_st keyFiles = {0};
+	if (key_files_dir == NULL
+	    && !KeyFiles_AllGen(lens, key_gen ? &key_alphabet : NULL)) {
+		printf("%s: needs -k for its key lengths\n", file_in_data);
+		exit(1);
+	}
+	keyFilesInit(&keyFiles, lens, key_files_dir, key_gen ? &key_alphabet : NULL);
+	PrimeStats_FileOutInit(file_out_data, lens);
+
+	//--------------------------------------------------------------------
+	// seeds: the best seeds_cnt records of the input
+	PrimeStats_SearchEntry_st* pool = calloc(seeds_cnt + 1, sizeof(*pool));
+	int poolCnt = 0;
+	for (uint64_t i = 0; i < file.recsCnt; i++) {
+		const void* rec = PrimeStats_FileRec(&file, i);
+		const PrimeStats_SearchEntry_st entry = {
+			.prime = PrimeStats_RecPrime(rec),
+			.score = searchScore(rec, lens->cnt),
+		};
+		// a prime in the input twice only gets one seed slot
+		if (searchSeenAdd(entry.prime)) {
+			searchPoolOffer(pool, &poolCnt, entry);
+		}
+	}
+	PrimeStats_FileClose(&file);
+
+	// anything a previous search already wrote
+	PrimeStats_File_st fileOut;
+	PrimeStats_FileOpen(&fileOut, file_out_data);
+	for (uint64_t i = 0; i < fileOut.recsCnt; i++) {
+		const void* rec = PrimeStats_FileRec(&fileOut, i);
+		const PrimeStats_SearchEntry_st entry = {
+			.prime = PrimeStats_RecPrime(rec),
+			.score = searchScore(rec, lens->cnt),
+		};
+		if (searchSeenAdd(entry.prime)) {
+			searchPoolOffer(pool, &poolCnt, entry);
+		}
+	}
+	PrimeStats_FileClose(&fileOut);
+
+	const double scoreStart = pool[0].score;
+	printf("seeds: %d, best %"PRIu64" score %.3f, worst kept %.3f\n",
+	       poolCnt, pool[0].prime, pool[0].score, pool[poolCnt - 1].score);
+	fflush(stdout);
+
+	//--------------------------------------------------------------------
+	uint64_t* cands = calloc(batch_cnt, sizeof(*cands));
+	uint8_t*  recs  = calloc(batch_cnt, recSize);
+
+	uint64_t evalTotal    = 0;
+	uint64_t entersTotal  = 0;
+	uint64_t compTotal    = 0;
+	uint64_t dupTotal     = 0;
+	const double cpuStart = cpuSeconds();
+
+	for (int gen = 1; gens_cnt <= 0 || gen <= gens_cnt; gen++)
+	{
+		// tournament of two picks the parent, which leans towards the best
+		// without starving the rest of the pool.
+		int candsCnt = 0;
+		uint64_t tries = (uint64_t)batch_cnt * 1024;
+		for (; candsCnt < batch_cnt && tries; tries--) {
+			const int a = _rng() % poolCnt;
+			const int b = _rng() % poolCnt;
+			const uint64_t cand = searchMutate(pool[a < b ? a : b].prime);
+			if (!searchSeenAdd(cand)) { dupTotal++;  continue; }
+			if (!isPrime64(cand))     { compTotal++; continue; }
+			cands[candsCnt++] = cand;
+		}
+		if (candsCnt == 0) {
+			printf("no new candidates left around the pool\n");
+			break;
+		}
+
+		searchEval(&keyFiles, lens, cands, candsCnt, recs);
+		fileAppendBytes(file_out_data, recs, candsCnt * recSize);
+
+		int enters = 0;
+		for (int i = 0; i < candsCnt; i++) {
+			const void* rec = recs + i * recSize;
+			const PrimeStats_SearchEntry_st entry = {
+				.prime = PrimeStats_RecPrime(rec),
+				.score = searchScore(rec, lens->cnt),
+			};
+			enters += searchPoolOffer(pool, &poolCnt, entry);
+		}
+		evalTotal   += candsCnt;
+		entersTotal += enters;
+
+		const double cpu      = cpuSeconds() - cpuStart;
+		const double cpuHours = cpu / 3600;
+		printf("gen %d: evaluated %d (total %"PRIu64", composite %"PRIu64
+		       ", seen %"PRIu64"), pool entries %d\n",
+		       gen, candsCnt, evalTotal, compTotal, dupTotal, enters);
+		printf("\tbest %"PRIu64" score %.3f (start %.3f), cpu %.1f s\n",
+		       pool[0].prime, pool[0].score, scoreStart, cpu);
+		if (cpuHours > 0) {
+			printf("\tper cpu-hour: score improvement %.3f, pool entries %.1f\n",
+			       (scoreStart - pool[0].score) / cpuHours,
+			       entersTotal / cpuHours);
+		}
+		fflush(stdout);
+
+		if (cpu_budget > 0 && cpu >= cpu_budget) { break; }
+	}
+
+	printf("\nfinal pool:\n");
+	for (int i = 0; i < poolCnt; i++) {
+		printf("\t%20"PRIu64"  %.3f\n", pool[i].prime, pool[i].score);
+	}
+
+	return 0;
+}
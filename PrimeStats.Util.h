@@ -89,7 +89,7 @@ void printU64WithCommas(uint64_t ns)
 
 //------------------------------------------------------------------------------
 void
-fileAppendBytes(char* filename, void* buf, int bufLen)
+fileAppendBytes(char* filename, void* buf, size_t bufLen)
 {
   FILE* fp;
   fp = fopen(filename, "a+");
@@ -2,19 +2,71 @@
 #define _PrimeStats_h_
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
-#define PS_KEYLEN_MAX 8
+#include <stdlib.h>
+
+// a run tests up to PS_KEYLEN_SLOTS key lengths, each 1..PS_KEYLEN_MAX bytes.
+// keys up to 8 bytes are hashed as one 64-bit word, longer keys through
+// _keyWordsHash().
+#define PS_KEYLEN_SLOTS 8
+#define PS_KEYLEN_MAX   64
 
 
 #define DBG_FFL {printf("DBG: File:[%s] Func:[%s] Line:[%d]\n",\
                  __FILE__, __FUNCTION__, __LINE__);fflush(stdout);}
 
 
-static const int _keyLenMin = 1;
-static const int _keyLenMax = PS_KEYLEN_MAX;
+//------------------------------------------------------------------------------
+// the key lengths a run was configured with. stats arrays are indexed by
+// slot (position in len[]), not by length.
+typedef struct PrimeStats_KeyLens_st {
+	int cnt;
+	int len[PS_KEYLEN_SLOTS];
+} PrimeStats_KeyLens_st;
+
+// 1..8, what every run used before key lengths were configurable
+void
+KeyLens_Default(PrimeStats_KeyLens_st* lens)
+{
+	lens->cnt = PS_KEYLEN_SLOTS;
+	for (int i = 0; i < lens->cnt; i++) {
+		lens->len[i] = i + 1;
+	}
+}
+
+// "1,2,3,16,32". returns false on a bad list.
+bool
+KeyLens_Parse(PrimeStats_KeyLens_st* lens, const char* str)
+{
+	lens->cnt = 0;
+	while (*str) {
+		char* end;
+		const long len = strtol(str, &end, 10);
+		if (end == str || len < 1 || len > PS_KEYLEN_MAX
+		    || lens->cnt == PS_KEYLEN_SLOTS) {
+			return false;
+		}
+		for (int i = 0; i < lens->cnt; i++) {
+			if (lens->len[i] == len) { return false; }
+		}
+		lens->len[lens->cnt++] = len;
+		str = end;
+		if (*str == ',') { str++; }
+		else if (*str)   { return false; }
+	}
+	return lens->cnt > 0;
+}
+
+bool
+KeyLens_Equal(const PrimeStats_KeyLens_st* a, const PrimeStats_KeyLens_st* b)
+{
+	return a->cnt == b->cnt
+	    && 0 == memcmp(a->len, b->len, a->cnt * sizeof(a->len[0]));
+}
 
 
 
@@ -45,15 +97,19 @@ typedef struct PrimeStats_BitsCntMeta_st {
 } PrimeStats_BitsCntMeta_st;
 
 typedef struct PrimeStats_Data_st {
-	PrimeStats_BitsCnt_st bits[PS_KEYLEN_MAX]; // hash bits accumulator
-	PrimeStats_BitsCnt_st ava [PS_KEYLEN_MAX]; // avalanching bits stats
+	PrimeStats_BitsCnt_st bits[PS_KEYLEN_SLOTS]; // hash bits accumulator
+	PrimeStats_BitsCnt_st ava [PS_KEYLEN_SLOTS]; // avalanching bits stats
 } PrimeStats_Data_st;
 
 typedef struct PrimeStats_Meta_st {
-  PrimeStats_BitsCntMeta_st bits[PS_KEYLEN_MAX];
-  PrimeStats_BitsCntMeta_st ava [PS_KEYLEN_MAX];
+  PrimeStats_BitsCntMeta_st bits[PS_KEYLEN_SLOTS];
+  PrimeStats_BitsCntMeta_st ava [PS_KEYLEN_SLOTS];
 } PrimeStats_Meta_st;
 
+// the working record, sized for every slot. on disk (and in the batch
+// buffers) records are packed to the configured slot count only, see
+// PrimeStats_Pack(). packing all PS_KEYLEN_SLOTS slots gives exactly this
+// struct's layout, which is what pre-header files hold.
 typedef struct PrimeStats_st {
 	uint64_t           prime;
 	PrimeStats_Data_st data;
@@ -77,6 +133,41 @@ _key64bHash(const uint64_t prime, const uint64_t key) {
 	return key * prime;
 }
 
+// keys longer than 8 bytes: split into little-endian 64-bit words (the last
+// one zero padded, same as _keyTo64b) and fold them in with
+//
+//   h = (rotl(h, 32) ^ word) * prime
+//
+// the multiply only carries low bits upwards, so the rotate is what lets the
+// high bits of earlier words reach the low bits of the result. h starts at 0,
+// so a single word hashes exactly like _key64bHash(prime, word).
+static inline uint64_t
+_hashWord(const uint64_t prime, const uint64_t h, const uint64_t word)
+{
+	return (((h << 32) | (h >> 32)) ^ word) * prime;
+}
+
+int
+_keyToWords(const uint8_t* key, const int len, uint64_t* words)
+{
+	const int wordsCnt = (len + 7) / 8;
+	for (int w = 0; w < wordsCnt; w++) {
+		const int wordLen = (w == wordsCnt - 1) ? len - w * 8 : 8;
+		words[w] = _keyTo64b(key + w * 8, wordLen);
+	}
+	return wordsCnt;
+}
+
+uint64_t
+_keyWordsHash(const uint64_t prime, const uint64_t* words, const int wordsCnt)
+{
+	uint64_t h = 0;
+	for (int w = 0; w < wordsCnt; w++) {
+		h = _hashWord(prime, h, words[w]);
+	}
+	return h;
+}
+
 //------------------------------------------------------------------------------
 void
 _bitsCntTest(PrimeStats_BitsCnt_st* bits, uint64_t val) {
@@ -125,15 +216,55 @@ _avaTest(PrimeStats_BitsCnt_st* ava,
 	}
 }
 
+// same as _avaTest, for multi-word keys. the hash state before every word is
+// kept, so a flipped bit only re-hashes from its own word onwards.
+void
+_avaTestWords(PrimeStats_BitsCnt_st* ava,
+              const uint64_t hashIni, const uint64_t prime,
+              const uint64_t* words,  const int wordsCnt, const int keyLen)
+{
+	uint64_t states[PS_KEYLEN_MAX / 8];
+	uint64_t h = 0;
+	for (int w = 0; w < wordsCnt; w++) {
+		states[w] = h;
+		h = _hashWord(prime, h, words[w]);
+	}
+
+	for (int w = 0; w < wordsCnt; w++)
+	{
+		// the padding bytes of the last word aren't part of the key
+		const int wordBits = (w == wordsCnt - 1) ? (keyLen - w * 8) * 8 : 64;
+		uint64_t mask = 1;
+		for (int i = 0; i < wordBits; i++) {
+			uint64_t hashNew = _hashWord(prime, states[w], words[w] ^ mask);
+			for (int r = w + 1; r < wordsCnt; r++) {
+				hashNew = _hashWord(prime, hashNew, words[r]);
+			}
+			_avaUpdate(ava, hashIni, hashNew);
+			mask <<= 1;
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 void
-_statsAddKey(PrimeStats_st* stats, const uint8_t* key, const int keyLen)
+_statsAddKey(PrimeStats_st* stats, const int slot,
+             const uint8_t* key, const int keyLen)
 {
-	const uint64_t key64b = _keyTo64b  (key,          keyLen);
-	const uint64_t hash   = _key64bHash(stats->prime, key64b);
-	const int      idx    = keyLen - 1;
-	_bitsCntTest(&stats->data.bits[idx], hash);
-	_avaTest    (&stats->data.ava [idx],  hash, stats->prime, key64b, keyLen);
+	if (keyLen <= 8) {
+		const uint64_t key64b = _keyTo64b  (key,          keyLen);
+		const uint64_t hash   = _key64bHash(stats->prime, key64b);
+		_bitsCntTest(&stats->data.bits[slot], hash);
+		_avaTest    (&stats->data.ava [slot],  hash, stats->prime, key64b, keyLen);
+		return;
+	}
+
+	uint64_t  words[PS_KEYLEN_MAX / 8];
+	const int wordsCnt = _keyToWords(key, keyLen, words);
+	const uint64_t hash = _keyWordsHash(stats->prime, words, wordsCnt);
+	_bitsCntTest (&stats->data.bits[slot], hash);
+	_avaTestWords(&stats->data.ava [slot], hash, stats->prime,
+	              words, wordsCnt, keyLen);
 }
 
 
@@ -144,6 +275,11 @@ void
 BitsCntMeta_Calc(const PrimeStats_BitsCnt_st*     bits,
                        PrimeStats_BitsCntMeta_st* meta)
 {
+	// sums are taken in 64 bits: with every 3 byte key (2^24 of them, 24
+	// avalanche values each) they don't fit in 32. avg stays exact, the
+	// stored sum saturates.
+	uint64_t sum;
+
 	meta->cnt = bits->valCnt;
 	//------------
 	meta->bit.min = UINT32_MAX;
@@ -151,15 +287,17 @@ BitsCntMeta_Calc(const PrimeStats_BitsCnt_st*     bits,
 	meta->bit.gap = 0;
 	meta->bit.sum = 0;
 	meta->bit.avg = 0;
+	sum = 0;
 	for (int i = 0; i < 64; i++) {
 		if (bits->bit[i] < meta->bit.min) {
 			meta->bit.min = bits->bit[i];
 		} else if (bits->bit[i] > meta->bit.max) {
 			meta->bit.max = bits->bit[i];
 		}
-		meta->bit.sum += bits->bit[i];
+		sum += bits->bit[i];
 	}
-	meta->bit.avg = meta->bit.sum / meta->cnt;
+	meta->bit.sum = sum > UINT32_MAX ? UINT32_MAX : sum;
+	meta->bit.avg = sum / meta->cnt;
 	meta->bit.gap = meta->bit.max - meta->bit.min;
 	//------------
 	meta->pop.min = UINT32_MAX;
@@ -167,6 +305,7 @@ BitsCntMeta_Calc(const PrimeStats_BitsCnt_st*     bits,
 	meta->pop.gap = 0;
 	meta->pop.sum = 0;
 	meta->pop.avg = 0;
+	sum = 0;
 	for (int i = 0; i < 64; i++) {
 		if (bits->pop[i] > 0) {
 			if (i < meta->pop.min) {
@@ -175,26 +314,27 @@ BitsCntMeta_Calc(const PrimeStats_BitsCnt_st*     bits,
 				meta->pop.max = i;
 			}
 		}
-		meta->pop.sum += (bits->pop[i] * (i+1)); // note the multiply here
+		sum += ((uint64_t)bits->pop[i] * (i+1)); // note the multiply here
 	}
-	meta->pop.avg = meta->pop.sum / meta->cnt;
+	meta->pop.sum = sum > UINT32_MAX ? UINT32_MAX : sum;
+	meta->pop.avg = sum / meta->cnt;
 	meta->pop.gap = meta->pop.max - meta->pop.min;
 }
 
 //------------------------------------------------------------------------------
 void
-PrimeStatsMeta_Calc(PrimeStats_st* stats)
+PrimeStatsMeta_Calc(PrimeStats_st* stats, const int slotsCnt)
 {
-	for (int i = _keyLenMin; i <= _keyLenMax; i++) {
-		const int idx = i - 1;
-		BitsCntMeta_Calc(&stats->data.bits[idx], &stats->meta.bits[idx]);
-		BitsCntMeta_Calc(&stats->data.ava [idx], &stats->meta.ava [idx]);
+	for (int slot = 0; slot < slotsCnt; slot++) {
+		BitsCntMeta_Calc(&stats->data.bits[slot], &stats->meta.bits[slot]);
+		BitsCntMeta_Calc(&stats->data.ava [slot], &stats->meta.ava [slot]);
 	}
 }
 
 //------------------------------------------------------------------------------
 void
 PrimeStats_RunKeys(PrimeStats_st* stats,
+                   const int      slot,
                    const void*    keys,
                    const uint64_t keyLen,
                    const uint64_t keysCnt,
@@ -206,11 +346,169 @@ PrimeStats_RunKeys(PrimeStats_st* stats,
 	}
 	const uint8_t* pos = keys;
 	for (int i = 0; i < iters; ++i) {
-		_statsAddKey(stats, pos, keyLen);
+		_statsAddKey(stats, slot, pos, keyLen);
     pos += keyLen;
   }
 }
 
+//------------------------------------------------------------------------------
+// generated keys: rather than the first maxKeys of a key file, every key of a
+// length over a byte alphabet. only for lengths up to PS_KEYGEN_LEN_MAX, so
+// at most 2^24 keys.
+#define PS_KEYGEN_LEN_MAX 3
+#define PS_KEYGEN_LANES   8
+
+typedef struct PrimeStats_Alphabet_st {
+	int     cnt;
+	uint8_t byte[256];
+} PrimeStats_Alphabet_st;
+
+// "all" (every byte value), "print" (printable ascii, 0x20..0x7e) or
+// "alnum". returns false on anything else.
+bool
+Alphabet_Parse(PrimeStats_Alphabet_st* alphabet, const char* str)
+{
+	alphabet->cnt = 0;
+	for (int c = 0; c < 256; c++) {
+		if (   (0 == strcmp(str, "all"))
+		    || (0 == strcmp(str, "print") && c >= 0x20 && c <= 0x7e)
+		    || (0 == strcmp(str, "alnum") && (   (c >= '0' && c <= '9')
+		                                      || (c >= 'A' && c <= 'Z')
+		                                      || (c >= 'a' && c <= 'z')))) {
+			alphabet->byte[alphabet->cnt++] = c;
+		}
+	}
+	return alphabet->cnt > 0;
+}
+
+uint64_t
+Alphabet_KeysCnt(const PrimeStats_Alphabet_st* alphabet, const int keyLen)
+{
+	uint64_t cnt = 1;
+	for (int i = 0; i < keyLen; i++) {
+		cnt *= alphabet->cnt;
+	}
+	return cnt;
+}
+
+// _bitsCntTest() does 64 adds per value, which is most of the work once keys
+// don't come from memory. here every byte of a value is spread out to 8
+// one-byte counters (bit j -> byte j) and added to that byte's lane, so it's
+// 8 adds. lanes are flushed into bit[] before a byte counter can wrap.
+#define _PS_SPREAD(b)                                                     \
+	((((((uint64_t)(b) * 0x0101010101010101ull) & 0x8040201008040201ull)    \
+	   + 0x7f7f7f7f7f7f7f7full) >> 7) & 0x0101010101010101ull)
+#define _PS_SPREAD4(b)   _PS_SPREAD(b),       _PS_SPREAD((b) + 1),   \
+                         _PS_SPREAD((b) + 2), _PS_SPREAD((b) + 3)
+#define _PS_SPREAD16(b)  _PS_SPREAD4(b),       _PS_SPREAD4((b) + 4),   \
+                         _PS_SPREAD4((b) + 8), _PS_SPREAD4((b) + 12)
+#define _PS_SPREAD64(b)  _PS_SPREAD16(b),        _PS_SPREAD16((b) + 16), \
+                         _PS_SPREAD16((b) + 32), _PS_SPREAD16((b) + 48)
+
+static const uint64_t _bitsSpread[256] = {
+	_PS_SPREAD64(0), _PS_SPREAD64(64), _PS_SPREAD64(128), _PS_SPREAD64(192)
+};
+
+typedef struct PrimeStats_BitsLanes_st {
+	uint64_t lane[8]; // byte j of lane k counts bit k * 8 + j
+	int      pending;
+} PrimeStats_BitsLanes_st;
+
+static inline void
+_bitsLanesFlush(PrimeStats_BitsCnt_st* bits, PrimeStats_BitsLanes_st* lanes)
+{
+	for (int k = 0; k < 8; k++) {
+		for (int j = 0; j < 8; j++) {
+			bits->bit[k * 8 + j] += (lanes->lane[k] >> (j * 8)) & 0xff;
+		}
+		lanes->lane[k] = 0;
+	}
+	lanes->pending = 0;
+}
+
+// same result as _bitsCntTest(bits, val), once flushed
+static inline void
+_bitsLanesTest(PrimeStats_BitsCnt_st* bits, PrimeStats_BitsLanes_st* lanes,
+               const uint64_t val)
+{
+	bits->valCnt++;
+	bits->pop[__builtin_popcountll(val)]++;
+	for (int k = 0; k < 8; k++) {
+		lanes->lane[k] += _bitsSpread[(val >> (k * 8)) & 0xff];
+	}
+	if (++lanes->pending == 255) {
+		_bitsLanesFlush(bits, lanes);
+	}
+}
+
+typedef uint64_t PrimeStats_KeyVec_t
+	__attribute__((vector_size(PS_KEYGEN_LANES * sizeof(uint64_t))));
+
+// every alphabet->cnt ^ keyLen key into slot. keys are built straight into
+// 64-bit words (same value _keyTo64b would give): the first key byte runs
+// across the lanes of a vector, the higher bytes are an odometer, so a whole
+// vector of keys and their hashes comes from one or and one multiply. the
+// stats are exactly what PrimeStats_RunKeys gives over a file of the same
+// keys.
+void
+PrimeStats_RunKeysGen(PrimeStats_st* stats,
+                      const int      slot,
+                      const int      keyLen,
+                      const PrimeStats_Alphabet_st* alphabet)
+{
+	PrimeStats_BitsCnt_st* bits = &stats->data.bits[slot];
+	PrimeStats_BitsCnt_st* ava  = &stats->data.ava [slot];
+	PrimeStats_BitsLanes_st bitsLanes = {0};
+	PrimeStats_BitsLanes_st avaLanes  = {0};
+
+	// the last vector is padded, its extra lanes are never counted
+	const int           loCnt = (alphabet->cnt + PS_KEYGEN_LANES - 1) / PS_KEYGEN_LANES;
+	PrimeStats_KeyVec_t lo[256 / PS_KEYGEN_LANES];
+	for (int i = 0; i < loCnt * PS_KEYGEN_LANES; i++) {
+		lo[i / PS_KEYGEN_LANES][i % PS_KEYGEN_LANES]
+			= alphabet->byte[i < alphabet->cnt ? i : 0];
+	}
+
+	const uint64_t hiCnt   = Alphabet_KeysCnt(alphabet, keyLen - 1);
+	const int      keyBits = keyLen * 8;
+	int            digit[PS_KEYGEN_LEN_MAX] = {0};
+	for (uint64_t iHi = 0; iHi < hiCnt; iHi++)
+	{
+		uint64_t hi = 0;
+		for (int d = 1; d < keyLen; d++) {
+			hi |= (uint64_t)alphabet->byte[digit[d]] << (d * 8);
+		}
+
+		for (int v = 0; v < loCnt; v++)
+		{
+			const int lanesCnt = alphabet->cnt - v * PS_KEYGEN_LANES < PS_KEYGEN_LANES
+			                   ? alphabet->cnt - v * PS_KEYGEN_LANES : PS_KEYGEN_LANES;
+			const PrimeStats_KeyVec_t key  = lo[v] | hi;
+			const PrimeStats_KeyVec_t hash = key * stats->prime;
+			for (int l = 0; l < lanesCnt; l++) {
+				_bitsLanesTest(bits, &bitsLanes, hash[l]);
+			}
+
+			uint64_t mask = 1;
+			for (int i = 0; i < keyBits; i++) {
+				const PrimeStats_KeyVec_t hashNew = (key ^ mask) * stats->prime;
+				for (int l = 0; l < lanesCnt; l++) {
+					_bitsLanesTest(ava, &avaLanes, _avaTestPair(hash[l], hashNew[l]));
+				}
+				mask <<= 1;
+			}
+		}
+
+		for (int d = 1; d < keyLen; d++) {
+			if (++digit[d] < alphabet->cnt) { break; }
+			digit[d] = 0;
+		}
+	}
+
+	_bitsLanesFlush(bits, &bitsLanes);
+	_bitsLanesFlush(ava,  &avaLanes);
+}
+
 //------------------------------------------------------------------------------
 void
 PrimeStats_Init(PrimeStats_st* stats, const uint64_t prime)
@@ -222,6 +520,98 @@ PrimeStats_Init(PrimeStats_st* stats, const uint64_t prime)
 
 
 
+//------------------------------------------------------------------------------
+// packed records: the prime, then bits[], ava[], meta.bits[], meta.ava[],
+// each with only slotsCnt entries.
+size_t
+PrimeStats_RecSize(const int slotsCnt)
+{
+	return sizeof(uint64_t)
+	     + slotsCnt * 2 * sizeof(PrimeStats_BitsCnt_st)
+	     + slotsCnt * 2 * sizeof(PrimeStats_BitsCntMeta_st);
+}
+
+static inline uint64_t
+PrimeStats_RecPrime(const void* rec)
+{
+	uint64_t prime;
+	memcpy(&prime, rec, sizeof(prime));
+	return prime;
+}
+
+static inline const PrimeStats_BitsCntMeta_st*
+PrimeStats_RecMetaBits(const void* rec, const int slotsCnt, const int slot)
+{
+	return (const PrimeStats_BitsCntMeta_st*)
+	       ((const uint8_t*)rec + sizeof(uint64_t)
+	        + slotsCnt * 2 * sizeof(PrimeStats_BitsCnt_st))
+	       + slot;
+}
+
+static inline const PrimeStats_BitsCntMeta_st*
+PrimeStats_RecMetaAva(const void* rec, const int slotsCnt, const int slot)
+{
+	return PrimeStats_RecMetaBits(rec, slotsCnt, slotsCnt + slot);
+}
+
+void
+PrimeStats_Pack(const PrimeStats_st* stats, const int slotsCnt, void* rec)
+{
+	uint8_t* pos = rec;
+	memcpy(pos, &stats->prime, sizeof(stats->prime));
+	pos += sizeof(stats->prime);
+	memcpy(pos, stats->data.bits, slotsCnt * sizeof(stats->data.bits[0]));
+	pos += slotsCnt * sizeof(stats->data.bits[0]);
+	memcpy(pos, stats->data.ava,  slotsCnt * sizeof(stats->data.ava[0]));
+	pos += slotsCnt * sizeof(stats->data.ava[0]);
+	memcpy(pos, stats->meta.bits, slotsCnt * sizeof(stats->meta.bits[0]));
+	pos += slotsCnt * sizeof(stats->meta.bits[0]);
+	memcpy(pos, stats->meta.ava,  slotsCnt * sizeof(stats->meta.ava[0]));
+}
+
+void
+PrimeStats_Unpack(const void* rec, const int slotsCnt, PrimeStats_st* stats)
+{
+	const uint8_t* pos = rec;
+	memset(stats, 0, sizeof(*stats));
+	memcpy(&stats->prime, pos, sizeof(stats->prime));
+	pos += sizeof(stats->prime);
+	memcpy(stats->data.bits, pos, slotsCnt * sizeof(stats->data.bits[0]));
+	pos += slotsCnt * sizeof(stats->data.bits[0]);
+	memcpy(stats->data.ava,  pos, slotsCnt * sizeof(stats->data.ava[0]));
+	pos += slotsCnt * sizeof(stats->data.ava[0]);
+	memcpy(stats->meta.bits, pos, slotsCnt * sizeof(stats->meta.bits[0]));
+	pos += slotsCnt * sizeof(stats->meta.bits[0]);
+	memcpy(stats->meta.ava,  pos, slotsCnt * sizeof(stats->meta.ava[0]));
+}
+
+//------------------------------------------------------------------------------
+// binary search by prime over packed records. they must be sorted by prime,
+// which is what PrimeStats.Merge writes. returns NULL if the prime isn't there.
+const void*
+PrimeStats_Find(const void* recs, const uint64_t recsCnt, const size_t recSize,
+                const uint64_t prime)
+{
+	const uint8_t* base = recs;
+	uint64_t lo = 0;
+	uint64_t hi = recsCnt;
+	while (lo < hi) {
+		const uint64_t mid = lo + (hi - lo) / 2;
+		if (PrimeStats_RecPrime(base + mid * recSize) < prime) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo < recsCnt && PrimeStats_RecPrime(base + lo * recSize) == prime) {
+		return base + lo * recSize;
+	}
+	return NULL;
+}
+
+
+
+
 //------------------------------------------------------------------------------
 void
 BitsCntMeta_PrintChart(const PrimeStats_BitsCntMeta_st* meta) {
@@ -240,9 +630,27 @@ BitsCntMeta_PrintChart(const PrimeStats_BitsCntMeta_st* meta) {
 	printf("\t\t\t\t.avg : %"PRIu32"\n", meta->pop.avg);
 }
 
+// one chart row: label, then the field at off of every slot's meta.
 void
-PrimeStatsMeta_PrintChart(const PrimeStats_st* stats)
+_printChartRow(const char* label, const PrimeStats_BitsCntMeta_st* metas,
+               const int slotsCnt, const size_t off)
 {
+	printf("%-16s", label);
+	for (int slot = 0; slot < slotsCnt; slot++) {
+		printf("%8d", (int)*(const uint32_t*)((const char*)&metas[slot] + off));
+	}
+	printf("\n");
+}
+
+#define _PS_CHART_ROW(label, metas, cnt, field) \
+	_printChartRow(label, metas, cnt, offsetof(PrimeStats_BitsCntMeta_st, field))
+
+void
+PrimeStatsMeta_PrintChart(const PrimeStats_st*         stats,
+                          const PrimeStats_KeyLens_st* lens)
+{
+	const int cnt = lens->cnt;
+
 	printf("\n");
 	printf("\n----------------------------------------"
 	         "----------------------------------------");
@@ -250,122 +658,41 @@ PrimeStatsMeta_PrintChart(const PrimeStats_st* stats)
 	printf("%20"PRIu64"\n", stats->prime);
 
 	printf("\n");
-	printf(".bits.cnt       %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].cnt, (int)stats->meta.bits[1].cnt,
-	       (int)stats->meta.bits[2].cnt, (int)stats->meta.bits[3].cnt,
-	       (int)stats->meta.bits[4].cnt, (int)stats->meta.bits[5].cnt,
-	       (int)stats->meta.bits[6].cnt, (int)stats->meta.bits[7].cnt);
-	printf(".bits.bit.min   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].bit.min, (int)stats->meta.bits[1].bit.min,
-	       (int)stats->meta.bits[2].bit.min, (int)stats->meta.bits[3].bit.min,
-	       (int)stats->meta.bits[4].bit.min, (int)stats->meta.bits[5].bit.min,
-	       (int)stats->meta.bits[6].bit.min, (int)stats->meta.bits[7].bit.min);
-	printf(".bits.bit.max   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].bit.max, (int)stats->meta.bits[1].bit.max,
-	       (int)stats->meta.bits[2].bit.max, (int)stats->meta.bits[3].bit.max,
-	       (int)stats->meta.bits[4].bit.max, (int)stats->meta.bits[5].bit.max,
-	       (int)stats->meta.bits[6].bit.max, (int)stats->meta.bits[7].bit.max);
-	printf(".bits.bit.sum   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].bit.sum, (int)stats->meta.bits[1].bit.sum,
-	       (int)stats->meta.bits[2].bit.sum, (int)stats->meta.bits[3].bit.sum,
-	       (int)stats->meta.bits[4].bit.sum, (int)stats->meta.bits[5].bit.sum,
-	       (int)stats->meta.bits[6].bit.sum, (int)stats->meta.bits[7].bit.sum);
-	printf(".bits.bit.gap   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].bit.gap, (int)stats->meta.bits[1].bit.gap,
-	       (int)stats->meta.bits[2].bit.gap, (int)stats->meta.bits[3].bit.gap,
-	       (int)stats->meta.bits[4].bit.gap, (int)stats->meta.bits[5].bit.gap,
-	       (int)stats->meta.bits[6].bit.gap, (int)stats->meta.bits[7].bit.gap);
-	printf(".bits.bit.avg   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].bit.avg, (int)stats->meta.bits[1].bit.avg,
-	       (int)stats->meta.bits[2].bit.avg, (int)stats->meta.bits[3].bit.avg,
-	       (int)stats->meta.bits[4].bit.avg, (int)stats->meta.bits[5].bit.avg,
-	       (int)stats->meta.bits[6].bit.avg, (int)stats->meta.bits[7].bit.avg);
+	printf("%-16s", ".len");
+	for (int slot = 0; slot < cnt; slot++) {
+		printf("%8d", lens->len[slot]);
+	}
+	printf("\n");
+
+	printf("\n");
+	_PS_CHART_ROW(".bits.cnt",     stats->meta.bits, cnt, cnt);
+	_PS_CHART_ROW(".bits.bit.min", stats->meta.bits, cnt, bit.min);
+	_PS_CHART_ROW(".bits.bit.max", stats->meta.bits, cnt, bit.max);
+	_PS_CHART_ROW(".bits.bit.sum", stats->meta.bits, cnt, bit.sum);
+	_PS_CHART_ROW(".bits.bit.gap", stats->meta.bits, cnt, bit.gap);
+	_PS_CHART_ROW(".bits.bit.avg", stats->meta.bits, cnt, bit.avg);
 
 	printf("\n");
-	printf(".bits.pop.min   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].pop.min, (int)stats->meta.bits[1].pop.min,
-	       (int)stats->meta.bits[2].pop.min, (int)stats->meta.bits[3].pop.min,
-	       (int)stats->meta.bits[4].pop.min, (int)stats->meta.bits[5].pop.min,
-	       (int)stats->meta.bits[6].pop.min, (int)stats->meta.bits[7].pop.min);
-	printf(".bits.pop.max   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].pop.max, (int)stats->meta.bits[1].pop.max,
-	       (int)stats->meta.bits[2].pop.max, (int)stats->meta.bits[3].pop.max,
-	       (int)stats->meta.bits[4].pop.max, (int)stats->meta.bits[5].pop.max,
-	       (int)stats->meta.bits[6].pop.max, (int)stats->meta.bits[7].pop.max);
-	printf(".bits.pop.sum   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].pop.sum, (int)stats->meta.bits[1].pop.sum,
-	       (int)stats->meta.bits[2].pop.sum, (int)stats->meta.bits[3].pop.sum,
-	       (int)stats->meta.bits[4].pop.sum, (int)stats->meta.bits[5].pop.sum,
-	       (int)stats->meta.bits[6].pop.sum, (int)stats->meta.bits[7].pop.sum);
-	printf(".bits.pop.gap   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].pop.gap, (int)stats->meta.bits[1].pop.gap,
-	       (int)stats->meta.bits[2].pop.gap, (int)stats->meta.bits[3].pop.gap,
-	       (int)stats->meta.bits[4].pop.gap, (int)stats->meta.bits[5].pop.gap,
-	       (int)stats->meta.bits[6].pop.gap, (int)stats->meta.bits[7].pop.gap);
-	printf(".bits.pop.avg   %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.bits[0].pop.avg, (int)stats->meta.bits[1].pop.avg,
-	       (int)stats->meta.bits[2].pop.avg, (int)stats->meta.bits[3].pop.avg,
-	       (int)stats->meta.bits[4].pop.avg, (int)stats->meta.bits[5].pop.avg,
-	       (int)stats->meta.bits[6].pop.avg, (int)stats->meta.bits[7].pop.avg);
+	_PS_CHART_ROW(".bits.pop.min", stats->meta.bits, cnt, pop.min);
+	_PS_CHART_ROW(".bits.pop.max", stats->meta.bits, cnt, pop.max);
+	_PS_CHART_ROW(".bits.pop.sum", stats->meta.bits, cnt, pop.sum);
+	_PS_CHART_ROW(".bits.pop.gap", stats->meta.bits, cnt, pop.gap);
+	_PS_CHART_ROW(".bits.pop.avg", stats->meta.bits, cnt, pop.avg);
 
 	printf("\n");
-	printf(".ava.cnt        %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].cnt, (int)stats->meta.ava[1].cnt,
-	       (int)stats->meta.ava[2].cnt, (int)stats->meta.ava[3].cnt,
-	       (int)stats->meta.ava[4].cnt, (int)stats->meta.ava[5].cnt,
-	       (int)stats->meta.ava[6].cnt, (int)stats->meta.ava[7].cnt);
-	printf(".ava.bit.min    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].bit.min, (int)stats->meta.ava[1].bit.min,
-	       (int)stats->meta.ava[2].bit.min, (int)stats->meta.ava[3].bit.min,
-	       (int)stats->meta.ava[4].bit.min, (int)stats->meta.ava[5].bit.min,
-	       (int)stats->meta.ava[6].bit.min, (int)stats->meta.ava[7].bit.min);
-	printf(".ava.bit.max    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].bit.max, (int)stats->meta.ava[1].bit.max,
-	       (int)stats->meta.ava[2].bit.max, (int)stats->meta.ava[3].bit.max,
-	       (int)stats->meta.ava[4].bit.max, (int)stats->meta.ava[5].bit.max,
-	       (int)stats->meta.ava[6].bit.max, (int)stats->meta.ava[7].bit.max);
-	printf(".ava.bit.sum    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].bit.sum, (int)stats->meta.ava[1].bit.sum,
-	       (int)stats->meta.ava[2].bit.sum, (int)stats->meta.ava[3].bit.sum,
-	       (int)stats->meta.ava[4].bit.sum, (int)stats->meta.ava[5].bit.sum,
-	       (int)stats->meta.ava[6].bit.sum, (int)stats->meta.ava[7].bit.sum);
-	printf(".ava.bit.gap    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].bit.gap, (int)stats->meta.ava[1].bit.gap,
-	       (int)stats->meta.ava[2].bit.gap, (int)stats->meta.ava[3].bit.gap,
-	       (int)stats->meta.ava[4].bit.gap, (int)stats->meta.ava[5].bit.gap,
-	       (int)stats->meta.ava[6].bit.gap, (int)stats->meta.ava[7].bit.gap);
-	printf(".ava.bit.avg    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].bit.avg, (int)stats->meta.ava[1].bit.avg,
-	       (int)stats->meta.ava[2].bit.avg, (int)stats->meta.ava[3].bit.avg,
-	       (int)stats->meta.ava[4].bit.avg, (int)stats->meta.ava[5].bit.avg,
-	       (int)stats->meta.ava[6].bit.avg, (int)stats->meta.ava[7].bit.avg);
+	_PS_CHART_ROW(".ava.cnt",      stats->meta.ava,  cnt, cnt);
+	_PS_CHART_ROW(".ava.bit.min",  stats->meta.ava,  cnt, bit.min);
+	_PS_CHART_ROW(".ava.bit.max",  stats->meta.ava,  cnt, bit.max);
+	_PS_CHART_ROW(".ava.bit.sum",  stats->meta.ava,  cnt, bit.sum);
+	_PS_CHART_ROW(".ava.bit.gap",  stats->meta.ava,  cnt, bit.gap);
+	_PS_CHART_ROW(".ava.bit.avg",  stats->meta.ava,  cnt, bit.avg);
 
 	printf("\n");
-	printf(".ava.pop.min    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].pop.min, (int)stats->meta.ava[1].pop.min,
-	       (int)stats->meta.ava[2].pop.min, (int)stats->meta.ava[3].pop.min,
-	       (int)stats->meta.ava[4].pop.min, (int)stats->meta.ava[5].pop.min,
-	       (int)stats->meta.ava[6].pop.min, (int)stats->meta.ava[7].pop.min);
-	printf(".ava.pop.max    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].pop.max, (int)stats->meta.ava[1].pop.max,
-	       (int)stats->meta.ava[2].pop.max, (int)stats->meta.ava[3].pop.max,
-	       (int)stats->meta.ava[4].pop.max, (int)stats->meta.ava[5].pop.max,
-	       (int)stats->meta.ava[6].pop.max, (int)stats->meta.ava[7].pop.max);
-	printf(".ava.pop.sum    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].pop.sum, (int)stats->meta.ava[1].pop.sum,
-	       (int)stats->meta.ava[2].pop.sum, (int)stats->meta.ava[3].pop.sum,
-	       (int)stats->meta.ava[4].pop.sum, (int)stats->meta.ava[5].pop.sum,
-	       (int)stats->meta.ava[6].pop.sum, (int)stats->meta.ava[7].pop.sum);
-	printf(".ava.pop.gap    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].pop.gap, (int)stats->meta.ava[1].pop.gap,
-	       (int)stats->meta.ava[2].pop.gap, (int)stats->meta.ava[3].pop.gap,
-	       (int)stats->meta.ava[4].pop.gap, (int)stats->meta.ava[5].pop.gap,
-	       (int)stats->meta.ava[6].pop.gap, (int)stats->meta.ava[7].pop.gap);
-	printf(".ava.pop.avg    %8d%8d%8d%8d%8d%8d%8d%8d\n",
-	       (int)stats->meta.ava[0].pop.avg, (int)stats->meta.ava[1].pop.avg,
-	       (int)stats->meta.ava[2].pop.avg, (int)stats->meta.ava[3].pop.avg,
-	       (int)stats->meta.ava[4].pop.avg, (int)stats->meta.ava[5].pop.avg,
-	       (int)stats->meta.ava[6].pop.avg, (int)stats->meta.ava[7].pop.avg);
+	_PS_CHART_ROW(".ava.pop.min",  stats->meta.ava,  cnt, pop.min);
+	_PS_CHART_ROW(".ava.pop.max",  stats->meta.ava,  cnt, pop.max);
+	_PS_CHART_ROW(".ava.pop.sum",  stats->meta.ava,  cnt, pop.sum);
+	_PS_CHART_ROW(".ava.pop.gap",  stats->meta.ava,  cnt, pop.gap);
+	_PS_CHART_ROW(".ava.pop.avg",  stats->meta.ava,  cnt, pop.avg);
 
 	fflush(stdout);
 }
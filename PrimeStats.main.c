@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include <inttypes.h>
 #include <stdbool.h>
 #include <string.h>
@@ -11,6 +13,11 @@
 
 #include "PrimeStats.h"
 #include "PrimeStats.Util.h"
+#include "PrimeStats.File.h"
+#include "PrimeStats.Keys.h"
+#include "PrimeStats.Metrics.h"
+#include "PrimeStats.Numa.h"
+#include "PrimeStats.DoneSet.h"
 
 //
 // keys are mapped to a file. that file is a constant string of keys,
@@ -24,59 +31,134 @@
 
 
 //==============================================================================
-static char* file_out_data   = NULL;
-static char* key_files_dir   = NULL;
-static char* prime_files_dir = NULL;
+static char* file_out_data    = NULL;
+static char* key_files_dir    = NULL;
+static char* prime_files_dir  = NULL;
+static char* file_out_metrics = NULL;
+static int   shard_idx        = 0;
+static int   shard_cnt        = 1;
+static int   workers_cnt      = 1;
+static bool  numa_mode        = false;
+
+#define PS_DONE_FILES_MAX 256
+static char* done_files[PS_DONE_FILES_MAX];
+static int   done_files_cnt   = 0;
+
+static PrimeStats_KeyLens_st  key_lens;
+static PrimeStats_Alphabet_st key_alphabet;
+static bool                   key_gen = false;
 
 
 //------------------------------------------------------------------------------
-typedef struct PrimeStats_KeyFileKeys_st {
-	      char     filePath[1024];
-	      off_t    fileSize;
-	const void*    keys;
-	      uint64_t keyCnt;
-	      int      keyLen;
-} PrimeStats_KeyFileKeys_st;
-
-typedef struct PrimeStats_KeyFiles_st {
-	PrimeStats_KeyFileKeys_st keyFile[8];
-	int                       keyLenMax;
-	int                       keyFilesCnt;
-} PrimeStats_KeyFiles_st;
-
-const char* keyFileNames[] = {
-	"toks.len.sequential.1.64.txt",
-	"toks.len.sequential.2.3929.txt",
-	"toks.len.sequential.3.201228.txt",
-	"toks.len.sequential.4.2429953.txt",
-	"toks.len.sequential.5.12629812.txt",
-	"toks.len.sequential.6.18510142.txt",
-	"toks.len.sequential.7.15311088.txt",
-	"toks.len.sequential.8.18679078.txt",
-};
+typedef struct PrimeStats_PrimeFile_st {
+	char     filePath[1024];
+	char     fileName[256];
+	uint64_t primeCnt;
+	uint64_t primeBeg; // this shard's slice of the file: [primeBeg, primeEnd)
+	uint64_t primeEnd;
+} PrimeStats_PrimeFile_st;
 
 //------------------------------------------------------------------------------
-bool
-keyFileInit(PrimeStats_KeyFiles_st* keyFiles, const char* dirName, const char* fileName)
+// lists the prime files up front so the total prime count (for eta) is known
+// before the sweep starts. sizes come from stat(), nothing is mapped here.
+//
+// files are sorted by name so every shard of a run sees the same list, no
+// matter what order readdir() hands them back in.
+int
+_primeFileCmp(const void* a, const void* b)
 {
-	int      keyLen = 0;
-	uint64_t keyCnt = 0;
-	sscanf(fileName, "toks.len.sequential.%d.%"PRIu64".txt", &keyLen, &keyCnt);
+	return strcmp(((const PrimeStats_PrimeFile_st*)a)->fileName,
+	              ((const PrimeStats_PrimeFile_st*)b)->fileName);
+}
 
-	int keyLenMax = sizeof(keyFiles->keyFile) / sizeof(keyFiles->keyFile[0]);
-	if (keyLen > keyLenMax) { return false; }
+PrimeStats_PrimeFile_st*
+primeFilesList(const char* dirName, int* filesCnt)
+{
+  DIR *dPrimes;
+  struct dirent *dirPrimes;
+  dPrimes = opendir(dirName);
+  if (!dPrimes) {
+  	printf("couldn't open prime files dir\n");
+  	exit(1);
+  }
 
-	int keyFileIdx = keyLen - 1;
-	sprintf(keyFiles->keyFile[keyFileIdx].filePath, "%s%s", dirName, fileName);
+	int filesCap = 64;
+	*filesCnt = 0;
+	PrimeStats_PrimeFile_st* files = malloc(filesCap * sizeof(*files));
+  while ((dirPrimes = readdir(dPrimes)) != NULL)
+  {
+  	if (strlen(dirPrimes->d_name) < 10) { continue; }
 
-	keyFiles->keyFile[keyFileIdx].keyLen = keyLen;
-	keyFiles->keyFile[keyFileIdx].keyCnt = keyCnt;
+  	if (*filesCnt == filesCap) {
+  		filesCap *= 2;
+  		files = realloc(files, filesCap * sizeof(*files));
+  	}
+  	PrimeStats_PrimeFile_st* file = &files[*filesCnt];
+  	snprintf(file->fileName, sizeof(file->fileName), "%s", dirPrimes->d_name);
+  	snprintf(file->filePath, sizeof(file->filePath), "%s%s",
+  	         dirName, dirPrimes->d_name);
+
+  	struct stat s;
+  	if (stat(file->filePath, &s) < 0) {
+  		printf("stat failed: %s: %s\n", file->filePath, strerror(errno));
+  		exit(1);
+  	}
+  	file->primeCnt = s.st_size / sizeof(uint64_t);
+  	(*filesCnt)++;
+  }
+  closedir(dPrimes);
+
+  qsort(files, *filesCnt, sizeof(*files), _primeFileCmp);
+
+  return files;
+}
 
-	keyFiles->keyFile[keyFileIdx].keys
-		= mmapFileToPtr( keyFiles->keyFile[keyFileIdx].filePath,
-		                &keyFiles->keyFile[keyFileIdx].fileSize);
+//------------------------------------------------------------------------------
+// every file is cut into shardCnt contiguous slices and this shard takes
+// slice shardIdx. slicing each file (rather than handing out whole files)
+// keeps shards balanced when there are fewer files than shards.
+uint64_t
+primeFilesShard(PrimeStats_PrimeFile_st* files, const int filesCnt,
+                const int shardIdx, const int shardCnt)
+{
+	uint64_t primesCnt = 0;
+	for (int i = 0; i < filesCnt; i++) {
+		files[i].primeBeg = files[i].primeCnt *  shardIdx      / shardCnt;
+		files[i].primeEnd = files[i].primeCnt * (shardIdx + 1) / shardCnt;
+		primesCnt += files[i].primeEnd - files[i].primeBeg;
+	}
+	return primesCnt;
+}
+
+//------------------------------------------------------------------------------
+// written once the sweep has finished, next to the output file. the merge
+// tool uses it to check that every shard of a run is present and complete.
+// existingCnt is what the output already held before this run (a resume), so
+// the file should hold existingCnt + recordsCnt records.
+void
+shardManifestWrite(const char* dataPath,
+                   const PrimeStats_PrimeFile_st* files, const int filesCnt,
+                   const uint64_t existingCnt,
+                   const uint64_t recordsCnt, const uint64_t skippedCnt)
+{
+	char manifestPath[1024];
+	snprintf(manifestPath, sizeof(manifestPath), "%s.shard", dataPath);
 
-	return true;
+	FILE* fp = fopen(manifestPath, "w");
+	if (fp == NULL) {
+		printf("shardManifestWrite(): can't open %s\n", manifestPath);
+		exit(1);
+	}
+	fprintf(fp, "shard %d %d\n", shard_idx, shard_cnt);
+	for (int i = 0; i < filesCnt; i++) {
+		fprintf(fp, "file %s %"PRIu64" %"PRIu64" %"PRIu64"\n",
+		        files[i].fileName, files[i].primeCnt,
+		        files[i].primeBeg, files[i].primeEnd);
+	}
+	fprintf(fp, "existing %"PRIu64"\n", existingCnt);
+	fprintf(fp, "records %"PRIu64"\n", recordsCnt);
+	fprintf(fp, "skipped %"PRIu64"\n", skippedCnt);
+	fclose(fp);
 }
 
 //------------------------------------------------------------------------------
@@ -91,6 +173,15 @@ printHelpAndExit()
 		"\n\t" "-o: output file : file_out_data"
 		"\n\t" "-k: keys dir    : key_files_dir"
 		"\n\t" "-p: primes file : prime_files_dir"
+		"\n\t" "-m: metrics file: file_out_metrics (optional, prometheus text)"
+		"\n\t" "-s: shard i/N   : run only slice i of N of every prime file"
+		"\n\t" "-t: threads     : workers_cnt (default 1)"
+		"\n\t" "-n: numa        : pin workers across nodes, node-local keys/buffers"
+		"\n\t" "-l: key lengths : comma separated, up to 8 of 1..64 (default 1,...,8)"
+		"\n\t" "-a: alphabet    : all|print|alnum, generate every key of lengths 1..3"
+		" over it instead of reading key files"
+		"\n\t" "-d: done file   : skip primes already in this data file (repeatable;"
+		" pass the -o file to resume a run)"
 		"\n\n"
 		"eg:\n"
 		"\n./PrimeStats.main"
@@ -108,7 +199,9 @@ cliOptsToCfg(int argc, char *argv[])
   int  opt;
   bool hasErr = false;
 
-  while ((opt = getopt(argc, argv, ":h:o:k:p:")) != -1)
+  KeyLens_Default(&key_lens);
+
+  while ((opt = getopt(argc, argv, ":h:o:k:p:m:s:t:nl:d:a:")) != -1)
   {
     switch(opt)
     {
@@ -123,6 +216,38 @@ cliOptsToCfg(int argc, char *argv[])
 		    break;
 			case 'p':
 		    prime_files_dir = optarg;
+		    break;
+			case 'm':
+		    file_out_metrics = optarg;
+		    break;
+			case 's':
+		    if (2 != sscanf(optarg, "%d/%d", &shard_idx, &shard_cnt)) {
+		    	hasErr = true;
+		    }
+		    break;
+			case 't':
+		    workers_cnt = atoi(optarg);
+		    break;
+			case 'n':
+		    numa_mode = true;
+		    break;
+			case 'd':
+		    if (done_files_cnt == PS_DONE_FILES_MAX) {
+		    	hasErr = true;
+		    	break;
+		    }
+		    done_files[done_files_cnt++] = optarg;
+		    break;
+			case 'l':
+		    if (!KeyLens_Parse(&key_lens, optarg)) {
+		    	hasErr = true;
+		    }
+		    break;
+			case 'a':
+		    if (!Alphabet_Parse(&key_alphabet, optarg)) {
+		    	hasErr = true;
+		    }
+		    key_gen = true;
 		    break;
 			default:
 				hasErr = true;
@@ -138,12 +263,19 @@ cliOptsToCfg(int argc, char *argv[])
 	if (file_out_data  == NULL) {
 		hasErr = true;
 	}
-	if (key_files_dir  == NULL) {
+	if (key_files_dir  == NULL
+	    && !KeyFiles_AllGen(&key_lens, key_gen ? &key_alphabet : NULL)) {
 		hasErr = true;
 	}
 	if (prime_files_dir == NULL) {
 		hasErr = true;
 	}
+	if (shard_cnt < 1 || shard_idx < 0 || shard_idx >= shard_cnt) {
+		hasErr = true;
+	}
+	if (workers_cnt < 1 || workers_cnt > PS_METRICS_WORKERS_MAX) {
+		hasErr = true;
+	}
 
   if (hasErr) {
   	printf("invalid options given.\n");
@@ -156,13 +288,228 @@ printCfg()
 {
 	printf("using config:\n");
 	printf("\tfile_out_data  : %s\n", file_out_data);
-	printf("\tkey_files_dir  : %s\n", key_files_dir);
+	printf("\tkey_files_dir  : %s\n", key_files_dir ? key_files_dir : "(none)");
 	printf("\tprime_files_dir : %s\n", prime_files_dir);
+	printf("\tfile_out_metrics: %s\n",
+	       file_out_metrics ? file_out_metrics : "(none)");
+	printf("\tshard           : %d/%d\n", shard_idx, shard_cnt);
+	printf("\tworkers_cnt     : %d%s\n", workers_cnt, numa_mode ? " (numa)" : "");
+	for (int i = 0; i < done_files_cnt; i++) {
+		printf("\tdone_file       : %s\n", done_files[i]);
+	}
+	printf("\tkey_lens        :");
+	for (int i = 0; i < key_lens.cnt; i++) {
+		printf(" %d", key_lens.len[i]);
+	}
+	printf("\n");
+	if (key_gen) {
+		printf("\tkey_alphabet    : %d bytes, lengths <= %d generated\n",
+		       key_alphabet.cnt, PS_KEYGEN_LEN_MAX);
+	}
 	printf("\n");
 	fflush(stdout);
 }
 
 
+//==============================================================================
+// the sweep is cut into jobs of at most statsBatchCnt primes from one file
+// slice. workers pull jobs off a shared counter and each job is written out
+// as one batch, so the output is a series of ascending runs in whatever
+// order workers finished (PrimeStats.Merge sorts that out).
+//
+// in numa mode every worker is pinned, the first worker on each node copies
+// the (capped) key sets into node-local memory for its node, and every
+// worker first-touches its own stats buffer after pinning.
+
+typedef struct PrimeStats_Job_st {
+	int      fileIdx;
+	uint64_t primeBeg;
+	uint64_t primeEnd;
+} PrimeStats_Job_st;
+
+typedef struct PrimeStats_Worker_st {
+	int                          workerIdx;
+	int                          nodeIdx; // into numa.nodes[], numa mode only
+	int                          cpu;
+	pthread_t                    thread;
+	PrimeStats_MetricsWorker_st* metrics;
+	uint64_t                     statsCnt;
+	uint64_t                     skippedCnt;
+} PrimeStats_Worker_st;
+
+static const int                statsBatchCnt  = 4096;
+static const int                maxKeysPerFile = 10000;
+
+static PrimeStats_PrimeFile_st* primeFiles;
+static int                      primeFilesCnt;
+static const uint64_t**         primeMaps;
+static PrimeStats_Job_st*       jobs;
+static int                      jobsCnt;
+static _Atomic int              jobNext;
+
+static PrimeStats_KeyFiles_st   keyFiles;
+static PrimeStats_KeyFiles_st   keyFilesNode[PS_NUMA_NODES_MAX];
+static uint64_t                 keysTotal;
+
+static PrimeStats_DoneSet_st    doneSet;
+
+static PrimeStats_Numa_st       numa;
+static pthread_barrier_t        numaKeysBarrier;
+static PrimeStats_Metrics_st    metrics;
+static pthread_mutex_t          outLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+//------------------------------------------------------------------------------
+void
+sweepJobsInit()
+{
+	int jobsCap = 64;
+	jobs = malloc(jobsCap * sizeof(*jobs));
+	for (int iFile = 0; iFile < primeFilesCnt; iFile++)
+	{
+		const PrimeStats_PrimeFile_st* file = &primeFiles[iFile];
+		for (uint64_t beg = file->primeBeg; beg < file->primeEnd;
+		     beg += statsBatchCnt) {
+			if (jobsCnt == jobsCap) {
+				jobsCap *= 2;
+				jobs = realloc(jobs, jobsCap * sizeof(*jobs));
+			}
+			jobs[jobsCnt].fileIdx  = iFile;
+			jobs[jobsCnt].primeBeg = beg;
+			jobs[jobsCnt].primeEnd = beg + statsBatchCnt < file->primeEnd
+			                       ? beg + statsBatchCnt : file->primeEnd;
+			jobsCnt++;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// only the first maxKeysPerFile keys of each file are ever read, so that's
+// all that gets copied.
+void
+keyFilesReplicate(PrimeStats_KeyFiles_st* dst, const PrimeStats_KeyFiles_st* src)
+{
+	*dst = *src;
+	for (int i = 0; i < src->keyFilesCnt; i++) {
+		const PrimeStats_KeyFileKeys_st* keyFile = &src->keyFile[i];
+		if (keyFile->keys == NULL) { continue; }
+
+		const uint64_t keyCnt = keyFile->keyCnt > maxKeysPerFile
+		                      ? maxKeysPerFile : keyFile->keyCnt;
+		const uint64_t bytes  = keyCnt * keyFile->keyLen;
+		void* keys = Numa_AllocLocal(bytes);
+		memcpy(keys, keyFile->keys, bytes);
+		dst->keyFile[i].keys     = keys;
+		dst->keyFile[i].fileSize = bytes;
+	}
+}
+
+//------------------------------------------------------------------------------
+void
+sweepWrite(PrimeStats_Worker_st* w, void* statsArr, const int statsCnt,
+           const uint64_t timeDiff)
+{
+	const size_t statsBytes = statsCnt * PrimeStats_RecSize(key_lens.cnt);
+
+	pthread_mutex_lock(&outLock);
+
+	printf("\nworker       : %d", w->workerIdx);
+	printf("\ntimerIterCnt : %d", statsCnt);
+	printf("\ntime taken   : ");
+	printU64WithCommas(timeDiff);
+	uint64_t nsPerPrime = timeDiff / (uint64_t)statsCnt;
+	printf("\nns Per Prime : ");
+	printU64WithCommas(nsPerPrime);
+	printf("\n");
+
+	fileAppendBytes(file_out_data, statsArr, statsBytes);
+	printf("\n");
+
+	pthread_mutex_unlock(&outLock);
+
+	_metricsAdd(&w->metrics->bytesWritten, statsBytes);
+	_metricsSet(&w->metrics->batchDepth,   0);
+}
+
+//------------------------------------------------------------------------------
+void*
+sweepWorker(void* arg)
+{
+	PrimeStats_Worker_st* w = arg;
+
+	const PrimeStats_KeyFiles_st* keys = &keyFiles;
+	if (numa_mode) {
+		if (!Numa_PinSelf(w->cpu)) {
+			printf("worker %d: couldn't pin to cpu %d\n", w->workerIdx, w->cpu);
+		}
+		// workers are dealt round-robin, so worker n < nodesCnt is the first
+		// on node n.
+		if (w->workerIdx < numa.nodesCnt) {
+			keyFilesReplicate(&keyFilesNode[w->nodeIdx], &keyFiles);
+		}
+		pthread_barrier_wait(&numaKeysBarrier);
+		keys = &keyFilesNode[w->nodeIdx];
+	}
+
+	// records are computed in one full-size working struct and packed into
+	// the batch, which is only as big as the configured key lengths need.
+	const size_t recSize       = PrimeStats_RecSize(key_lens.cnt);
+	const size_t statsArrBytes = statsBatchCnt * recSize;
+	uint8_t* statsArr = numa_mode
+	                  ? Numa_AllocLocal(statsArrBytes)
+	                  : calloc(statsBatchCnt, recSize);
+	PrimeStats_st* stats = numa_mode
+	                     ? Numa_AllocLocal(sizeof(*stats))
+	                     : calloc(1, sizeof(*stats));
+
+	for (;;)
+	{
+		const int iJob = atomic_fetch_add_explicit(&jobNext, 1,
+		                                           memory_order_relaxed);
+		if (iJob >= jobsCnt) { break; }
+
+		const PrimeStats_Job_st* job      = &jobs[iJob];
+		const uint64_t*          primeMap = primeMaps[job->fileIdx];
+		Metrics_SetFile(w->metrics, job->fileIdx);
+
+		struct timespec timeStart = timerStart();
+
+		PrimeStats_DoneCursor_st done;
+		DoneSet_Seek(&done, &doneSet, primeMap[job->primeBeg]);
+
+		int statsCnt = 0;
+		for (uint64_t iPrime = job->primeBeg; iPrime < job->primeEnd; iPrime++)
+		{
+			if (DoneSet_Has(&done, primeMap[iPrime])) {
+				_metricsAdd(&w->metrics->primesSkipped, 1);
+				w->skippedCnt++;
+				continue;
+			}
+
+			PrimeStats_Init(stats, primeMap[iPrime]);
+
+			PrimeStats_RunKeyFiles(stats, keys, maxKeysPerFile);
+			PrimeStatsMeta_Calc(stats, key_lens.cnt);
+			PrimeStats_Pack(stats, key_lens.cnt, statsArr + statsCnt * recSize);
+			statsCnt++;
+
+			_metricsAdd(&w->metrics->primesDone, 1);
+			_metricsAdd(&w->metrics->keysDone,   keysTotal);
+			_metricsSet(&w->metrics->batchDepth, statsCnt);
+		}
+
+		if (statsCnt) {
+			sweepWrite(w, statsArr, statsCnt, timerEnd(timeStart));
+			memset(statsArr, 0, statsCnt * recSize);
+			w->statsCnt += statsCnt;
+		}
+	}
+
+	Metrics_SetFile(w->metrics, -1);
+	return NULL;
+}
+
+
 //==============================================================================
 int
 main(int argc, char *argv[])
@@ -170,110 +517,100 @@ main(int argc, char *argv[])
 	cliOptsToCfg(argc, argv);
 	printCfg();
 
-  DIR *dPrimes;
-  struct dirent *dirPrimes;
-  dPrimes = opendir(prime_files_dir);
-  if (!dPrimes) {
-  	printf("couldn't open prime files dir\n");
-  	exit(1);
-  }
+	if (numa_mode) {
+		Numa_Init(&numa);
+		Numa_Print(&numa);
+	}
+
+  primeFiles = primeFilesList(prime_files_dir, &primeFilesCnt);
+
+  keyFilesInit(&keyFiles, &key_lens, key_files_dir,
+               key_gen ? &key_alphabet : NULL);
+  keysTotal = KeyFiles_KeysTotal(&keyFiles, maxKeysPerFile);
+
+  PrimeStats_FileOutInit(file_out_data, &key_lens);
 
-  PrimeStats_KeyFiles_st keyFiles = {0};
-  keyFiles.keyLenMax   = 8;
-  keyFiles.keyFilesCnt = 8;
-  for (int i = 0; i < keyFiles.keyFilesCnt; ++i) {
-	  keyFileInit(&keyFiles, key_files_dir, keyFileNames[i]);
+  // records already in the output (resuming with -d <the -o file>)
+  PrimeStats_File_st fileOut;
+  PrimeStats_FileOpen(&fileOut, file_out_data);
+  const uint64_t existingCnt = fileOut.recsCnt;
+  PrimeStats_FileClose(&fileOut);
+
+  //--------------------------------------------------------------------
+  const char** primeFileNames = malloc(primeFilesCnt * sizeof(char*));
+  for (int i = 0; i < primeFilesCnt; i++) {
+  	primeFileNames[i] = primeFiles[i].fileName;
+  }
+  const uint64_t primesTotal
+  	= primeFilesShard(primeFiles, primeFilesCnt, shard_idx, shard_cnt);
+
+  // mapped once up front; pages only come in as jobs touch them.
+  primeMaps = calloc(primeFilesCnt, sizeof(*primeMaps));
+  off_t* primeMapsBytes = calloc(primeFilesCnt, sizeof(*primeMapsBytes));
+  for (int i = 0; i < primeFilesCnt; i++) {
+  	if (primeFiles[i].primeEnd == primeFiles[i].primeBeg) { continue; }
+  	primeMaps[i] = mmapFileToPtr(primeFiles[i].filePath, &primeMapsBytes[i]);
+  }
+  sweepJobsInit();
+
+  if (done_files_cnt) {
+  	struct timespec timeStart = timerStart();
+  	for (int i = 0; i < done_files_cnt; i++) {
+  		DoneSet_AddFile(&doneSet, done_files[i], &key_lens);
+  	}
+  	DoneSet_Finish(&doneSet);
+  	printf("done set: %"PRIu64" primes, ", doneSet.cnt);
+  	printU64WithCommas(timerEnd(timeStart));
+  	printf(" ns\n\n");
+  	fflush(stdout);
   }
-  const int maxKeysPerFile = 10000;
-  const uint64_t keysTotal
-  	= (keyFiles.keyFile[0].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[0].keyCnt)
-  	+ (keyFiles.keyFile[1].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[1].keyCnt)
-  	+ (keyFiles.keyFile[2].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[2].keyCnt)
-  	+ (keyFiles.keyFile[3].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[3].keyCnt)
-  	+ (keyFiles.keyFile[4].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[4].keyCnt)
-  	+ (keyFiles.keyFile[5].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[5].keyCnt)
-  	+ (keyFiles.keyFile[6].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[6].keyCnt)
-  	+ (keyFiles.keyFile[7].keyCnt > maxKeysPerFile
-  	   ? maxKeysPerFile : keyFiles.keyFile[7].keyCnt);
+
+  Metrics_Init(&metrics, file_out_metrics, workers_cnt);
+  metrics.primesTotal = primesTotal;
+  metrics.fileNames   = primeFileNames;
+  metrics.filesCnt    = primeFilesCnt;
+  Metrics_Start(&metrics);
 
   //--------------------------------------------------------------------
-        int statsCnt      = 0;
-  const int statsBatchCnt = 4096;
+  if (numa_mode) {
+  	pthread_barrier_init(&numaKeysBarrier, NULL, workers_cnt);
+  }
 
-  PrimeStats_st* statsArr = calloc(statsBatchCnt, sizeof(*statsArr));
-  while ((dirPrimes = readdir(dPrimes)) != NULL)
-  {
-  	if (strlen(dirPrimes->d_name) < 10) { continue; }
+  PrimeStats_Worker_st* workers = calloc(workers_cnt, sizeof(*workers));
+  for (int i = 0; i < workers_cnt; i++) {
+  	PrimeStats_Worker_st* w = &workers[i];
+  	w->workerIdx = i;
+  	w->metrics   = &metrics.worker[i];
+  	w->cpu       = -1;
+  	if (numa_mode) {
+  		w->nodeIdx = Numa_WorkerPlace(&numa, i, &w->cpu);
+  		printf("worker %d: node %d, cpu %d\n",
+  		       i, numa.nodes[w->nodeIdx].node, w->cpu);
+  	}
+  	if (pthread_create(&w->thread, NULL, sweepWorker, w) != 0) {
+  		printf("pthread_create failed\n");
+  		exit(1);
+  	}
+  }
+  fflush(stdout);
+
+  uint64_t statsCnt   = 0;
+  uint64_t skippedCnt = 0;
+  for (int i = 0; i < workers_cnt; i++) {
+  	pthread_join(workers[i].thread, NULL);
+  	statsCnt   += workers[i].statsCnt;
+  	skippedCnt += workers[i].skippedCnt;
+  }
+  if (skippedCnt) {
+  	printf("\nskipped %"PRIu64" primes already in the done set\n", skippedCnt);
+  }
 
-  	char primesFilePath[1024] = {0};
-
-  	sprintf(primesFilePath, "%s%s", prime_files_dir, dirPrimes->d_name);
-    printf("\nfilename: %s\n", dirPrimes->d_name); fflush(stdout);
-
-		uint64_t primesFileBytes = 0;
-		const void* primesArr = mmapFileToPtr(primesFilePath, &primesFileBytes);
-
-	  uint64_t* primeMap  = (uint64_t*)primesArr;
-	  const int numPrimes = primesFileBytes / sizeof(*primeMap);
-
-	  //------------------------------------------------------
-	  struct timespec timeStart = timerStart();
-
-	  int timerIterCnt = 0;
-	  for (int iPrime = 0; iPrime < numPrimes; iPrime++)
-	  {
-	    //--------------------------------
-	  	timerIterCnt++;
-	  	const int statsArrIdx = statsCnt % statsBatchCnt;
-	    PrimeStats_st* stats = &statsArr[statsArrIdx];
-	    PrimeStats_Init(stats, primeMap[iPrime]);
-
-	    //--------------------------------
-	    for (int iKeyFile = 0; iKeyFile < keyFiles.keyFilesCnt; iKeyFile++) {
-				PrimeStats_RunKeys(stats,
-				                   keyFiles.keyFile[iKeyFile].keys,
-				                   keyFiles.keyFile[iKeyFile].keyLen,
-				                   keyFiles.keyFile[iKeyFile].keyCnt,
-				                   maxKeysPerFile);
-	    }
-
-			PrimeStatsMeta_Calc(stats);
-
-	    //--------------------------------
-	    if (statsArrIdx == (statsBatchCnt - 1))
-	    {
-			  uint64_t timeDiff = timerEnd(timeStart);
-
-			  printf("\ntimerIterCnt : %d", timerIterCnt);
-			  printf("\ntime taken   : ");
-			  printU64WithCommas(timeDiff);
-			  uint64_t nsPerPrime = timeDiff / (uint64_t)timerIterCnt;
-			  printf("\nns Per Prime : ");
-			  printU64WithCommas(nsPerPrime);
-			  printf("\n");
-
-	    	fileAppendBytes(file_out_data, statsArr,
-	    	                statsBatchCnt * sizeof(*statsArr));
-			  printf("\n");
-
-			  memset(statsArr, 0, statsBatchCnt * sizeof(*statsArr));
-
-			  timerIterCnt = 0;
-			  timeStart = timerStart();
-	    }
-
-	    statsCnt++;
-	  }
-	  //------------------------------------------------------
+  for (int i = 0; i < primeFilesCnt; i++) {
+  	if (primeMaps[i]) { munmap((void*)primeMaps[i], primeMapsBytes[i]); }
   }
+  shardManifestWrite(file_out_data, primeFiles, primeFilesCnt,
+                     existingCnt, statsCnt, skippedCnt);
 
-  closedir(dPrimes);
+  Metrics_Stop(&metrics);
 	exit(1);
 }